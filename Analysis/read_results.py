@@ -0,0 +1,58 @@
+"""Read binary Wilson loop result files written by main.exe -r binary."""
+
+from __future__ import division, print_function
+import sys
+import numpy as np
+
+HEADER_DTYPE = np.dtype([('magic', 'S8'), ('version', '<u4'), ('header_bytes', '<u4'),
+                         ('fields', 'S32'), ('shape', '<u8', (4,)), ('max_r', '<u8'),
+                         ('max_t', '<u8'), ('name_bytes', '<u8'), ('record_bytes', '<u8'),
+                         ('padding', 'S16')])
+
+
+def read_header(path):
+    """Return the header of a result file as a dict."""
+    header = np.fromfile(path, dtype=HEADER_DTYPE, count=1)[0]
+    if header['magic'] != b'LQCDWL01':
+        raise ValueError(path + ' is not a Wilson loop result file')
+    return {'shape': tuple(int(n) for n in header['shape']),
+            'max_r': int(header['max_r']), 'max_t': int(header['max_t']),
+            'fields': header['fields'].decode().split(','),
+            'header_bytes': int(header['header_bytes']),
+            'name_bytes': int(header['name_bytes']),
+            'record_bytes': int(header['record_bytes'])}
+
+
+def read_results(path):
+    """Memory-map the records of a result file without copying.
+    Returns the header and a record array with fields 'name' (bytes) and 'data',
+    where data[config, R-1, T-1] holds (mean, std, count)."""
+    header = read_header(path)
+    record = np.dtype([('name', 'S{}'.format(header['name_bytes'])),
+                       ('data', '<f8', (header['max_r'], header['max_t'], len(header['fields'])))])
+    assert record.itemsize == header['record_bytes']
+    size = np.memmap(path, dtype=np.uint8, mode='r').size
+    n_records = (size - header['header_bytes'])//record.itemsize  # Ignore a partly written last record
+    records = np.memmap(path, dtype=record, mode='r', offset=header['header_bytes'], shape=(n_records,))
+    return header, records
+
+
+def to_dataframe(path):
+    """Long-format pandas DataFrame with columns Config, R, T, Mean, Std, Count, as in the combined CSV output."""
+    import pandas as pd
+    header, records = read_results(path)
+    max_r, max_t = header['max_r'], header['max_t']
+    r, t = np.meshgrid(np.arange(1, max_r+1), np.arange(1, max_t+1), indexing='ij')
+    n = len(records)
+    values = records['data'].reshape(n*max_r*max_t, -1)
+    return pd.DataFrame({'Config': np.repeat([x.decode() for x in records['name']], max_r*max_t),
+                         'R': np.tile(r.ravel(), n), 'T': np.tile(t.ravel(), n),
+                         'Mean': values[:, 0], 'Std': values[:, 1], 'Count': values[:, 2].astype(np.int64)})
+
+
+if __name__ == "__main__":
+    header, records = read_results(sys.argv[1])
+    print('Lattice {}, R <= {}, T <= {}, {} configs'.format(
+        'x'.join(str(n) for n in header['shape']), header['max_r'], header['max_t'], len(records)))
+    for record in records:
+        print(record['name'].decode(), 'W(1,1) = {} +- {}'.format(*record['data'][0, 0, :2]))
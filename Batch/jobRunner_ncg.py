@@ -9,13 +9,17 @@ import glob
 SOFTDIR = "/lstore/cms/giles/LatticeQCD_IST2018/"
 
 
-def make_job_file(uid, input_file, output_dir):
-    """Build and submit analysis job."""
-    output_file = output_dir + str(uid) + '.csv'
+def make_job_file(uid, input_file, output_dir, multi=False):
+    """Build and submit analysis job.
+    With multi, input_file is a comma-separated list of configs measured in one process.
+    Each job checkpoints its progress, so a resubmitted job resumes where it was killed."""
+    output_file = output_dir if multi else output_dir + str(uid) + '.csv'
+    checkpoint_file = output_dir + "analysis_" + str(uid) + ".ckpt"
 
     cmd = "./bin/main.exe "
     cmd += "-i " + input_file
     cmd += " -o " + output_file
+    cmd += " -c " + checkpoint_file
 
     job_name = "analysis_" + str(uid) + ".job"
     job_file = open(job_name, "w")
@@ -42,6 +46,8 @@ if __name__ == "__main__":
                       help="Number of files to run")
     parser.add_option("-o", "--output_dir", dest="output_dir", action="store",
                       default='Output/', help="Output directory")
+    parser.add_option("-b", "--batch", dest="batch", action="store", default=1,
+                      help="Number of configs measured per job")
     opts, args = parser.parse_args()
 
     samples = glob.glob(opts.input_dir + '*.bin')
@@ -49,6 +55,11 @@ if __name__ == "__main__":
     if opts.n > 0:
         samples = samples[0:int(opts.n)]
 
-    for i, sample in enumerate(samples):
-        make_job_file(i, sample, opts.output_dir)
-        # break
+    batch = int(opts.batch)
+    if batch > 1:
+        for i in range(0, len(samples), batch):
+            make_job_file(i//batch, ','.join(samples[i:i+batch]), opts.output_dir, multi=True)
+    else:
+        for i, sample in enumerate(samples):
+            make_job_file(i, sample, opts.output_dir)
+            # break
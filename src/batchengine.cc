@@ -0,0 +1,166 @@
+#include "batchengine.hh"
+
+LinkBatch::LinkBatch(std::array<size_t, 4> shape, size_t lanes) : _shape(shape), _lanes(lanes), _links(nullptr) {
+    /*Allocate aligned storage for lanes configurations of the given shape, zeroed from the threads that will measure
+    each (t,z) plane as LinkField does, and tabulate neighbours*/
+    _volume = _shape[0]*_shape[1]*_shape[2]*_shape[3];
+    if (_volume > UINT32_MAX) throw std::runtime_error("Lattice volume too large for 32-bit site indices");
+    if (_lanes == 0) throw std::runtime_error("A link batch needs at least one lane");
+    size_t bytes = ((getBytes() + LinkField::alignment - 1)/LinkField::alignment)*LinkField::alignment;
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, LinkField::alignment, bytes) != 0) throw std::bad_alloc();
+    _links = static_cast<double*>(ptr);
+
+    const size_t nPlanes = _shape[2]*_shape[3];
+    const size_t planeDoubles = 4*_shape[0]*_shape[1]*getBatchSize();
+    #pragma omp parallel
+    {
+#ifdef _OPENMP
+        size_t thread = omp_get_thread_num(), nThreads = omp_get_num_threads();
+#else
+        size_t thread = 0, nThreads = 1;
+#endif
+        size_t begin = getPartBegin(nPlanes, thread, nThreads), end = getPartBegin(nPlanes, thread+1, nThreads);
+        memset(_links + begin*planeDoubles, 0, (end - begin)*planeDoubles*sizeof(double));
+    }
+    buildNeighbourTables(_shape, _forward, _backward);
+}
+
+LinkBatch::~LinkBatch() {
+    free(_links);
+}
+
+void LinkBatch::setLane(size_t lane, const LinkField& links) {
+    /*Copy every link of a configuration into lane, decoding compressed link formats*/
+    if (lane >= _lanes) throw std::runtime_error("Lane " + std::to_string(lane) + " is beyond the link batch");
+    if (links.getShape() != _shape) throw std::runtime_error("Configuration shape does not match link batch");
+    const size_t batchSize = getBatchSize();
+
+    #pragma omp parallel for schedule(static)
+    for (size_t site = 0; site < _volume; site++) {
+        for (size_t d = 0; d < 4; d++) {
+            std::complex<double> scratch[LinkField::linkSize];
+            const std::complex<double>* link = links.fetch(site, d, scratch);
+            double* target = _links + (4*site + d)*batchSize;
+            for (size_t e = 0; e < LinkField::linkSize; e++) {
+                target[2*e*_lanes + lane] = link[e].real();
+                target[(2*e+1)*_lanes + lane] = link[e].imag();
+            }
+        }
+    }
+}
+
+BatchWilsonEngine::BatchWilsonEngine(const LinkBatch& links, size_t maxR, size_t maxT) : _links(links), _maxR(maxR), _maxT(maxT) { }
+
+template <class Geometry>
+void BatchWilsonEngine::buildLines(const Geometry& geometry, size_t site, size_t dir, double* spatial, double* temporal) {
+    /*Spatial lines S(x+tau*t, r) in spatial[tau][r] and temporal lines L(x+r*dir, tau) in temporal[r][tau] of every
+    lane, as WilsonEngine::buildLines*/
+    const size_t n = _links.getBatchSize(), lanes = _links.getLanes();
+    size_t base = site;
+    for (size_t tau = 0; tau <= _maxT; tau++) { //Spatial lines at each height
+        double* line = spatial + tau*(_maxR+1)*n;
+        size_t point = base;
+        const double* link = _links.fetch(point, dir);
+        std::copy(link, link + n, line + n);
+        for (size_t r = 2; r <= _maxR; r++) {
+            point = geometry.next(point, dir);
+            su3::mulBatch(line + (r-1)*n, _links.fetch(point, dir), line + r*n, lanes);
+        }
+        base = geometry.next(base, 3);
+    }
+
+    base = site;
+    for (size_t r = 0; r <= _maxR; r++) { //Temporal lines at each distance
+        double* line = temporal + r*(_maxT+1)*n;
+        size_t point = base;
+        const double* link = _links.fetch(point, 3);
+        std::copy(link, link + n, line + n);
+        for (size_t tau = 2; tau <= _maxT; tau++) {
+            point = geometry.next(point, 3);
+            su3::mulBatch(line + (tau-1)*n, _links.fetch(point, 3), line + tau*n, lanes);
+        }
+        base = geometry.next(base, dir);
+    }
+}
+
+template <class Geometry>
+void BatchWilsonEngine::accumulateSite(const Geometry& geometry, size_t site, size_t dir, double* spatial, double* temporal, double* scratch, RunningStats* stats) {
+    /*Add all loops based at site in spatial direction dir to stats, which holds getEntries() entries per lane*/
+    const size_t n = _links.getBatchSize(), lanes = _links.getLanes();
+    const size_t nEntries = getEntries();
+    buildLines(geometry, site, dir, spatial, temporal);
+
+    double* upper = scratch;
+    double* lower = scratch + n;
+    double* traces = scratch + 2*n;
+    for (size_t R = 1; R <= _maxR; R++) {
+        for (size_t T = 1; T <= _maxT; T++) {
+            su3::mulBatch(spatial + R*n, temporal + (R*(_maxT+1) + T)*n, upper, lanes); //S(x,R).L(x+R,T)
+            su3::mulBatch(temporal + T*n, spatial + (T*(_maxR+1) + R)*n, lower, lanes); //L(x,T).S(x+T,R)
+            su3::reTraceMulDagBatch(upper, lower, traces, lanes);
+            for (size_t l = 0; l < lanes; l++) stats[l*nEntries + index(R, T)].add(traces[l]/3.);
+        }
+    }
+}
+
+std::vector<std::vector<RunningStats>> BatchWilsonEngine::calcStats() {
+    /*Mean, variance and count of Wilson loops for each lane and (R,T), indexed by [lane][index(R,T)]. Each lane gets
+    the statistics WilsonEngine::calcStats gives for its configuration, up to rounding*/
+    return dispatchGeometry(_links, [this](const auto& geometry) { return calcStats(geometry); });
+}
+
+template <class Geometry>
+std::vector<std::vector<RunningStats>> BatchWilsonEngine::calcStats(const Geometry& geometry) {
+    /*Per-lane Wilson loop statistics walking the lattice with the given geometry, one (t,z) plane per work item*/
+    const size_t n = _links.getBatchSize(), lanes = _links.getLanes();
+    const size_t planeSites = _links.getShape()[0]*_links.getShape()[1];
+    const size_t nZ = _links.getShape()[2], nT = _links.getShape()[3];
+    const size_t nEntries = getEntries();
+
+    std::vector<RunningStats> planeStats(nT*nZ*lanes*nEntries);
+    auto setup = [&]() {
+        return std::vector<double>(2*(_maxT+1)*(_maxR+1)*n + 2*n + lanes); //Spatial and temporal lines, then scratch
+    };
+    auto work = [&](std::vector<double>& buffer, size_t plane) {
+        double* spatial = buffer.data();
+        double* temporal = spatial + (_maxT+1)*(_maxR+1)*n;
+        double* scratch = temporal + (_maxR+1)*(_maxT+1)*n;
+        RunningStats* stats = planeStats.data() + plane*lanes*nEntries;
+        for (size_t site = plane*planeSites; site < (plane+1)*planeSites; site++) { //Loop over sites in plane
+            for (size_t i = 0; i < 3; i++) { //Direction iteration
+                accumulateSite(geometry, site, i, spatial, temporal, scratch, stats);
+            }
+        }
+    };
+    scheduleWork(std::vector<double>(nT*nZ, 1.), setup, work);
+
+    //Merge planes into timeslices and timeslices into totals in the order WilsonEngine uses
+    RunningStats identity;
+    identity.count = 3*_links.getVolume();
+    identity.mean = 1.;
+    std::vector<std::vector<RunningStats>> stats(lanes, std::vector<RunningStats>(nEntries, identity));
+    for (size_t l = 0; l < lanes; l++) {
+        for (size_t R = 1; R <= _maxR; R++) {
+            for (size_t T = 1; T <= _maxT; T++) {
+                RunningStats total;
+                for (size_t t = 0; t < nT; t++) { //Loop over t
+                    RunningStats slice;
+                    for (size_t z = 0; z < nZ; z++) slice.merge(planeStats[((t*nZ + z)*lanes + l)*nEntries + index(R, T)]);
+                    total.merge(slice);
+                }
+                stats[l][index(R, T)] = total;
+            }
+        }
+    }
+    return stats;
+}
+
+timing::Work BatchWilsonEngine::getWork() const {
+    /*Matrix products, counting one per lane, and bytes of batched links read by calcStats*/
+    const double maxR = _maxR, maxT = _maxT;
+    const double bases = 3.*_links.getVolume();
+    const double lineProducts = (maxT+1)*std::max(maxR-1, 0.) + (maxR+1)*std::max(maxT-1, 0.);
+    const double linkReads = (maxT+1)*maxR + (maxR+1)*maxT;
+    return {bases*_links.getLanes()*(lineProducts + 3*maxR*maxT), bases*linkReads*_links.getBatchSize()*sizeof(double)};
+}
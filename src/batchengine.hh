@@ -0,0 +1,82 @@
+#ifndef BATCHENGINE_HH_
+#define BATCHENGINE_HH_
+
+//C++
+#include <array>
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+//OpenMP
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "geometry.hh"
+#include "statistics.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+
+class LinkBatch {
+	/*Links of several configurations of the same shape, one per lane, interleaved so that the same matrix element of
+	every lane is contiguous. Each link is held as the lane-interleaved doubles of the su3 batch kernels, whatever the
+	format of the configurations it was filled from, and links are ordered by site and direction as in LinkField*/
+
+private:
+	std::array<size_t, 4> _shape;
+	size_t _volume;
+	size_t _lanes;
+	double* _links;
+	std::vector<uint32_t> _forward;
+	std::vector<uint32_t> _backward;
+
+public:
+	LinkBatch(std::array<size_t, 4>, size_t);
+	LinkBatch(const LinkBatch&) = delete;
+	LinkBatch& operator=(const LinkBatch&) = delete;
+	~LinkBatch();
+
+	std::array<size_t, 4> getShape() const { return _shape; }
+	size_t getVolume() const { return _volume; }
+	size_t getSpatialVolume() const { return _shape[0]*_shape[1]*_shape[2]; }
+	size_t getLanes() const { return _lanes; }
+	size_t getBatchSize() const { return 2*LinkField::linkSize*_lanes; } //Doubles per batched link
+	size_t getBytes() const { return 4*_volume*getBatchSize()*sizeof(double); }
+
+	size_t next(size_t site, size_t dir) const { return _forward[4*site + dir]; }
+	size_t prev(size_t site, size_t dir) const { return _backward[4*site + dir]; }
+	const double* fetch(size_t site, size_t dir) const { return _links + (4*site + dir)*getBatchSize(); }
+	void setLane(size_t, const LinkField&);
+};
+
+class BatchWilsonEngine {
+	/*Wilson loop statistics of every configuration of a LinkBatch at once. The loops are built exactly as by
+	WilsonEngine, but every product and trace acts on all lanes, so the same instruction stream serves several
+	configurations and vector registers are filled across configurations rather than within one matrix.
+	Statistics are kept per lane and merged in the same fixed order as WilsonEngine*/
+
+private:
+	const LinkBatch& _links;
+	size_t _maxR, _maxT;
+
+	template <class Geometry>
+	void buildLines(const Geometry&, size_t, size_t, double*, double*);
+	template <class Geometry>
+	void accumulateSite(const Geometry&, size_t, size_t, double*, double*, double*, RunningStats*);
+	template <class Geometry>
+	std::vector<std::vector<RunningStats>> calcStats(const Geometry&);
+
+public:
+	BatchWilsonEngine(const LinkBatch&, size_t, size_t);
+	size_t index(size_t R, size_t T) const { return R*(_maxT+1) + T; }
+	size_t getEntries() const { return (_maxR+1)*(_maxT+1); }
+	std::vector<std::vector<RunningStats>> calcStats();
+	timing::Work getWork() const;
+};
+
+#endif /* BATCHENGINE_HH_ */
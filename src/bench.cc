@@ -0,0 +1,341 @@
+#include "bench.hh"
+
+//Model floating-point operation counts
+const double flopsMul = 198; //SU(3) product: 27 complex multiplies and 18 complex adds
+const double flopsTraceMulDag = 70; //tr(U.V^dagger): 9 complex multiplies and 8 complex adds
+const double flopsReTraceMulDag = 35; //Re tr(U.V^dagger): 9 real dot products of two and 8 adds
+
+size_t maxThreads() {
+    /*Threads available to OpenMP*/
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+void setThreads(size_t threads) {
+    /*Threads used by following parallel regions*/
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#else
+    if (threads != 1) throw std::runtime_error("Built without OpenMP, only one thread is available");
+#endif
+}
+
+void showHelp() {
+    /*Show help for input arguments*/
+    std::cout << "-g : Lattice shapes Nx,Ny,Nz,Nt separated by ';', default 8,8,8,16;16,16,16,32\n";
+    std::cout << "-n : Thread counts separated by ',', default powers of two up to the number of OpenMP threads\n";
+    std::cout << "-c : Start [hot/cold/<spread>], hot for Haar random links, cold for unit links, else spread of near-unit links, default 0.2\n";
+    std::cout << "-s : Random seed, default 1\n";
+    std::cout << "-k : Config storage [disk/memory], disk writes configs to the work directory and times readConfig, default disk\n";
+    std::cout << "-w : Work directory for generated configs, default /tmp\n";
+    std::cout << "-f : In-memory link format [double/tworow/float/tworowfloat], default double\n";
+    std::cout << "-r : Repetitions of each benchmark, of which the fastest is reported, default 3\n";
+    std::cout << "-l : Label recorded in the output, e.g. a commit hash, default none\n";
+    std::cout << "-o : Output JSON file, default Output/bench.json\n";
+    std::cout << "-a : Thread affinity [none/compact/spread], default none. Threads are pinned again for each thread count\n";
+}
+
+std::map<std::string, std::string> getOptions(int argc, char* argv[]) {
+    /*Interpret input arguments*/
+    std::map<std::string, std::string> options;
+    options.insert(std::make_pair("-g", "8,8,8,16;16,16,16,32")); //Lattice shapes
+    options.insert(std::make_pair("-n", "")); //Thread counts
+    options.insert(std::make_pair("-c", "0.2")); //Start
+    options.insert(std::make_pair("-s", "1")); //Seed
+    options.insert(std::make_pair("-k", "disk")); //Storage
+    options.insert(std::make_pair("-w", "/tmp")); //Work directory
+    options.insert(std::make_pair("-f", "double")); //Link format
+    options.insert(std::make_pair("-r", "3")); //Repetitions
+    options.insert(std::make_pair("-l", "")); //Label
+    options.insert(std::make_pair("-o", "Output/bench.json")); //Output name
+    options.insert(std::make_pair("-a", "none")); //Thread affinity
+
+    for (int i = 1; i < argc; i = i+2) {
+        std::string option(argv[i]);
+        if (option == "-h" || option == "--help" || i+1 == argc) { //Check if help was requested
+            showHelp();
+            options.clear();
+            return options;
+        }
+        options[option] = argv[i+1];
+    }
+    return options;
+}
+
+std::vector<std::string> split(std::string text, char separator) {
+    /*Non-empty fields of text between separators*/
+    std::vector<std::string> fields;
+    std::stringstream stream(text);
+    std::string field;
+    while (std::getline(stream, field, separator)) {
+        if (field != "") fields.push_back(field);
+    }
+    return fields;
+}
+
+std::vector<size_t> getThreadCounts(std::string option) {
+    /*Thread counts to benchmark, defaulting to powers of two up to and including the maximum*/
+    std::vector<size_t> counts;
+    if (option == "") {
+        for (size_t n = 1; n < maxThreads(); n *= 2) counts.push_back(n);
+        counts.push_back(maxThreads());
+        return counts;
+    }
+    for (std::string field : split(option, ',')) {
+        size_t n = std::stoul(field);
+        if (n == 0) throw std::runtime_error("Invalid thread count: " + field);
+        counts.push_back(n);
+    }
+    return counts;
+}
+
+template <class Function>
+double timeBest(size_t repetitions, Function&& function) {
+    /*Fastest wall-clock time in seconds of repeated calls*/
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < repetitions; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+nlohmann::json makeResult(std::string name, std::array<size_t, 4> shape, size_t threads, double seconds,
+                          std::string unit, double items, double flops) {
+    /*Record of one benchmark. Rates are per second, flops are counted from the model costs above and omitted if zero*/
+    nlohmann::json result;
+    result["benchmark"] = name;
+    result["shape"] = shape;
+    result["threads"] = threads;
+    result["seconds"] = seconds;
+    result[unit] = items;
+    result[unit + "PerSecond"] = items/seconds;
+    if (flops > 0) result["gflops"] = flops/seconds/1e9;
+    std::cout << name << " on " << threads << " threads: " << seconds << " s, " << items/seconds << " " << unit << "/s";
+    if (flops > 0) std::cout << ", " << flops/seconds/1e9 << " GFLOP/s";
+    std::cout << "\n";
+    return result;
+}
+
+nlohmann::json benchKernels(size_t repetitions) {
+    /*Throughput of the SU(3) kernels of every supported kernel set on one thread, over cache-resident Haar random links*/
+    nlohmann::json results = nlohmann::json::array();
+    ConfigGenerator generator({8, 8, 8, 2}, "hot", 1);
+    const size_t sliceLinks = 4*8*8*8;
+    const size_t nLinks = 2*sliceLinks, n = LinkField::linkSize;
+    std::vector<std::complex<double>> links(nLinks*n), out(nLinks*n);
+    for (size_t t = 0; t < 2; t++) generator.generateSlice(t, links.data() + t*sliceLinks*n);
+    const size_t passes = 64;
+    const double products = passes*nLinks;
+    std::string original = su3::kernels.name;
+    double sink = 0;
+
+    for (std::string name : su3::availableKernels()) {
+        su3::selectKernels(name);
+        double seconds = timeBest(repetitions, [&]() {
+            for (size_t pass = 0; pass < passes; pass++) {
+                for (size_t i = 0; i < nLinks; i++) su3::mul(links.data() + i*n, links.data() + ((i+pass+1)%nLinks)*n, out.data() + i*n);
+            }
+        });
+        sink += out[0].real();
+        nlohmann::json result = makeResult("su3::mul[" + name + "]", {0, 0, 0, 0}, 1, seconds, "products", products, products*flopsMul);
+        result["kernels"] = name;
+        results.push_back(result);
+
+        seconds = timeBest(repetitions, [&]() {
+            for (size_t pass = 0; pass < passes; pass++) {
+                for (size_t i = 0; i < nLinks; i++) su3::mulDagRight(links.data() + i*n, links.data() + ((i+pass+1)%nLinks)*n, out.data() + i*n);
+            }
+        });
+        sink += out[0].real();
+        result = makeResult("su3::mulDagRight[" + name + "]", {0, 0, 0, 0}, 1, seconds, "products", products, products*flopsMul);
+        result["kernels"] = name;
+        results.push_back(result);
+
+        double total = 0;
+        seconds = timeBest(repetitions, [&]() {
+            for (size_t pass = 0; pass < passes; pass++) {
+                for (size_t i = 0; i < nLinks; i++) total += su3::reTraceMulDag(links.data() + i*n, links.data() + ((i+pass+1)%nLinks)*n);
+            }
+        });
+        sink += total;
+        result = makeResult("su3::reTraceMulDag[" + name + "]", {0, 0, 0, 0}, 1, seconds, "traces", products, products*flopsReTraceMulDag);
+        result["kernels"] = name;
+        results.push_back(result);
+    }
+    su3::selectKernels(original);
+    if (sink == 0.5) std::cout << "\n"; //Keep results live
+    return results;
+}
+
+nlohmann::json benchShape(std::array<size_t, 4> shape, const std::vector<size_t>& threadCounts,
+                          std::map<std::string, std::string>& options) {
+    /*Time loading and every measurement on one lattice shape for each thread count. Measured values are recorded
+    alongside the timings so that a change in results between commits is caught as well as a change in speed*/
+    if (shape[0] < 2 || shape[3] < 4) throw std::runtime_error("Benchmark shapes need Nx >= 2 and Nt >= 4");
+    nlohmann::json results = nlohmann::json::array();
+    const size_t repetitions = std::stoul(options["-r"]);
+    const bool disk = options["-k"] == "disk";
+    const double volume = shape[0]*shape[1]*shape[2]*shape[3];
+    const double nLinks = 4*volume;
+    const size_t maxR = shape[0]/2, maxT = shape[3]/4;
+    const size_t R = std::min<size_t>(2, maxR), T = std::min<size_t>(2, maxT);
+    const double nTableLoops = 3*volume*maxR*maxT;
+    const double tableLineMuls = (maxT+1)*(maxR-1) + (maxR+1)*(maxT-1);
+
+    ConfigGenerator generator(shape, options["-c"], std::stoull(options["-s"]));
+    std::stringstream name;
+    name << options["-w"] << "/SU3_" << shape[0] << "_" << shape[1] << "_" << shape[2] << "_" << shape[3] << "_bench_" << options["-s"] << ".bin";
+    const std::string nativeName = name.str() + ".native";
+    if (disk) {
+        setThreads(maxThreads());
+        double seconds = timeBest(1, [&]() { generator.write(name.str()); });
+        results.push_back(makeResult("writeConfig", shape, maxThreads(), seconds, "links", nLinks, 0));
+
+        seconds = timeBest(1, [&]() { //Native copy in the most compact format, as produced by convert.exe
+            ConfigFile raw(name.str(), shape);
+            ConfigWriter native(nativeName, shape, LinkFormat::twoRowSingle);
+            std::vector<std::complex<double>> slice(4*raw.getSpatialVolume()*LinkField::linkSize);
+            for (size_t t = 0; t < shape[3]; t++) {
+                raw.readSlices(t, 1, slice.data());
+                native.writeSlice(t, slice.data());
+            }
+            native.finish();
+        });
+        results.push_back(makeResult("convertConfig", shape, maxThreads(), seconds, "links", nLinks, 0));
+    }
+
+    double value = 0;
+    for (size_t threads : threadCounts) {
+        setThreads(threads);
+        topology::pinThreads(options["-a"]);
+        Lattice lattice(shape, "", "", "", "check", options["-f"]); //Allocated per thread count, so that its pages are first touched by these threads
+        nlohmann::json result;
+
+        double seconds = timeBest(repetitions, [&]() { lattice.generateConfig(generator); });
+        results.push_back(makeResult("generateConfig", shape, threads, seconds, "links", nLinks, 0));
+
+        if (disk) {
+            seconds = timeBest(repetitions, [&]() { lattice.readConfig(name.str()); });
+            result = makeResult("readConfig", shape, threads, seconds, "links", nLinks, 0);
+            result["bytesPerSecond"] = nLinks*LinkField::linkSize*sizeof(std::complex<double>)/seconds;
+            results.push_back(result);
+
+            seconds = timeBest(repetitions, [&]() { lattice.readConfig(nativeName); });
+            result = makeResult("readConfigNative", shape, threads, seconds, "links", nLinks, 0);
+            result["bytesPerSecond"] = ConfigFile(nativeName, shape).getBytes()/seconds;
+            results.push_back(result);
+        }
+
+        seconds = timeBest(repetitions, [&]() { value = lattice.getOverallPlaquetteMean(); });
+        result = makeResult("plaquette", shape, threads, seconds, "plaquettes", 6*volume, 6*volume*(2*flopsMul + flopsTraceMulDag));
+        result["value"] = value;
+        results.push_back(result);
+
+        seconds = timeBest(repetitions, [&]() { value = lattice.calcOverallMeanWilsonLoopMP(R, T); });
+        result = makeResult("wilsonLoop", shape, threads, seconds, "loops", 3*volume, 3*volume*2*(R+T)*flopsMul);
+        result["R"] = R;
+        result["T"] = T;
+        result["value"] = value;
+        results.push_back(result);
+
+        seconds = timeBest(repetitions, [&]() { value = lattice.calcWilsonLoopTable(maxR, maxT)(R, T).mean; });
+        result = makeResult("wilsonTable", shape, threads, seconds, "loops", nTableLoops,
+                            nTableLoops*(2*flopsMul + flopsReTraceMulDag) + 3*volume*tableLineMuls*flopsMul);
+        result["maxR"] = maxR;
+        result["maxT"] = maxT;
+        result["value"] = value;
+        results.push_back(result);
+
+        for (size_t lanes : {4, 8}) { //The same config in every lane, so each lane's value matches wilsonTable
+            LinkBatch batch(shape, lanes);
+            for (size_t l = 0; l < lanes; l++) batch.setLane(l, lattice.getLinks());
+            BatchWilsonEngine engine(batch, maxR, maxT);
+            seconds = timeBest(repetitions, [&]() { value = engine.calcStats()[lanes-1][engine.index(R, T)].mean; });
+            result = makeResult("wilsonTableBatch" + std::to_string(lanes), shape, threads, seconds, "loops", lanes*nTableLoops,
+                                lanes*(nTableLoops*(2*flopsMul + flopsReTraceMulDag) + 3*volume*tableLineMuls*flopsMul));
+            result["maxR"] = maxR;
+            result["maxT"] = maxT;
+            result["lanes"] = lanes;
+            result["value"] = value;
+            results.push_back(result);
+        }
+
+        std::vector<Path> paths;
+        for (std::array<int, 3> loopShape : std::vector<std::array<int, 3>>{{1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {2, 1, 0}}) {
+            for (std::array<int, 3> r : getOrientations(loopShape)) {
+                for (size_t loopT = 1; loopT <= maxT; loopT++) paths.push_back(makeWilsonPath(r, loopT));
+            }
+        }
+        seconds = timeBest(repetitions, [&]() { value = lattice.calcPathStats(paths)[0].mean; });
+        result = makeResult("paths", shape, threads, seconds, "loops", volume*paths.size(), PathEngine(lattice.getLinks(), paths).getWork().multiplies*flopsMul);
+        result["paths"] = paths.size();
+        result["value"] = value;
+        results.push_back(result);
+
+        seconds = timeBest(1, [&]() { lattice.fixTemporalGauge(); });
+        results.push_back(makeResult("temporalGauge", shape, threads, seconds, "links", nLinks, volume*7*flopsMul));
+
+        seconds = timeBest(repetitions, [&]() { value = lattice.calcWilsonLoopTable(maxR, maxT)(R, T).mean; });
+        result = makeResult("wilsonTableTemporal", shape, threads, seconds, "loops", nTableLoops, 0);
+        result["maxR"] = maxR;
+        result["maxT"] = maxT;
+        result["value"] = value;
+        results.push_back(result);
+
+        for (std::string method : {"ape", "hyp"}) { //One iteration per repetition
+            SmearingParameters smearing = parseSmearing(method + ":1");
+            seconds = timeBest(repetitions, [&]() { lattice.smearLinks(smearing); });
+            results.push_back(makeResult(method + "Smearing", shape, threads, seconds, "links", 3*volume, 0));
+        }
+    }
+
+    if (disk) {
+        std::remove(name.str().c_str());
+        std::remove(nativeName.c_str());
+    }
+    return results;
+}
+
+int main(int argc, char *argv[]) {
+    std::map<std::string, std::string> options = getOptions(argc, argv); //Get parsed arguments
+    if (options.size() == 0) {
+        return 1;
+    }
+    if (options["-k"] != "disk" && options["-k"] != "memory") throw std::runtime_error("Unknown config storage: " + options["-k"]);
+    parseLinkFormat(options["-f"]);
+    std::vector<size_t> threadCounts = getThreadCounts(options["-n"]);
+
+    nlohmann::json report;
+    report["label"] = options["-l"];
+    report["date"] = std::time(nullptr);
+    report["kernels"] = su3::kernels.name;
+    report["maxThreads"] = maxThreads();
+    report["start"] = options["-c"];
+    report["seed"] = std::stoull(options["-s"]);
+    report["storage"] = options["-k"];
+    report["format"] = options["-f"];
+    report["repetitions"] = std::stoul(options["-r"]);
+    report["affinity"] = options["-a"];
+    topology::report(std::cout, options["-a"], topology::pinThreads(options["-a"]));
+
+    std::cout << "Benchmarking SU(3) kernels\n";
+    nlohmann::json results = benchKernels(std::stoul(options["-r"]));
+    for (std::string text : split(options["-g"], ';')) {
+        std::array<size_t, 4> shape = parseShape(text);
+        std::cout << "Benchmarking lattice shape: " << shape[0] << "x" << shape[1] << "x" << shape[2] << "x" << shape[3] << "\n";
+        for (nlohmann::json& result : benchShape(shape, threadCounts, options)) results.push_back(result);
+    }
+    report["results"] = results;
+
+    std::ofstream outFile(options["-o"]);
+    if (!outFile) throw std::runtime_error("Cannot open output file " + options["-o"]);
+    outFile << report.dump(2) << "\n";
+    std::cout << "Results written to: " << options["-o"] << "\n";
+    return 0;
+}
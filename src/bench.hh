@@ -0,0 +1,32 @@
+#ifndef BENCH_HH_
+#define BENCH_HH_
+//c++
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <array>
+#include <complex>
+#include <map>
+#include <chrono>
+#include <ctime>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+//OpenMP
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+//JSON
+#include "nlohmann/json.hpp"
+//project
+#include "lattice.hh"
+#include "batchengine.hh"
+#include "generator.hh"
+#include "geometry.hh"
+#include "su3.hh"
+#include "topology.hh"
+
+#endif /* BENCH_HH_ */
@@ -0,0 +1,218 @@
+#include "checkpoint.hh"
+
+namespace {
+    enum RecordType : uint32_t { sliceRecord = 1, configRecord = 2 };
+    const size_t recordHeaderBytes = 16; //Type, CRC and payload size
+
+    template <class T>
+    void put(std::string& payload, const T& value) {
+        payload.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(std::string& payload, const std::string& text) {
+        put<uint64_t>(payload, text.size());
+        payload += text;
+    }
+
+    class PayloadReader {
+        /*Sequential reader of the fields of a record payload, throwing if a field runs past its end*/
+
+    private:
+        const std::string& _payload;
+        size_t _position;
+
+        void check(size_t bytes) {
+            if (bytes > _payload.size() - _position) throw std::runtime_error("Truncated checkpoint record");
+        }
+
+    public:
+        PayloadReader(const std::string& payload) : _payload(payload), _position(0) { }
+
+        template <class T>
+        T get() {
+            check(sizeof(T));
+            T value;
+            memcpy(&value, _payload.data() + _position, sizeof(T));
+            _position += sizeof(T);
+            return value;
+        }
+
+        std::string getString() {
+            size_t bytes = get<uint64_t>();
+            check(bytes);
+            std::string text = _payload.substr(_position, bytes);
+            _position += bytes;
+            return text;
+        }
+
+        bool atEnd() const { return _position == _payload.size(); }
+    };
+
+    uint32_t recordCrc(uint32_t type, uint64_t bytes, const std::string& payload) {
+        /*CRC of a record's type, size and payload*/
+        uint32_t crc = checksum::crc32(&type, sizeof(type));
+        crc = checksum::crc32(&bytes, sizeof(bytes), crc);
+        return checksum::crc32(payload.data(), payload.size(), crc);
+    }
+}
+
+Checkpoint::Checkpoint(std::string name, uint64_t key, uint64_t resultBytes) : _name(name), _fd(-1), _size(0), _config(0) {
+    /*Open checkpoint file, resuming from the records of an existing file written by a run with the same key, or starting
+    an empty one that remembers the size of the binary result file. Throws rather than overwrite a file that belongs to a
+    run with different arguments or is not a checkpoint*/
+    memset(&_header, 0, sizeof(_header));
+    memcpy(_header.magic, "LQCDCK01", 8);
+    _header.key = key;
+    _header.resultBytes = resultBytes;
+    _header.crc = checksum::crc32(&_header, offsetof(CheckpointHeader, crc));
+
+    _fd = open(_name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) throw std::runtime_error("Could not open checkpoint file: " + _name);
+    struct stat info;
+    if (fstat(_fd, &info) != 0) {
+        close(_fd);
+        throw std::runtime_error("Could not stat checkpoint file: " + _name);
+    }
+    size_t fileSize = static_cast<size_t>(info.st_size);
+
+    if (fileSize == 0) {
+        if (pwrite(_fd, &_header, sizeof(_header), 0) != static_cast<ssize_t>(sizeof(_header)) || fsync(_fd) != 0) {
+            close(_fd);
+            throw std::runtime_error("Could not write checkpoint file: " + _name);
+        }
+        _size = sizeof(_header);
+        return;
+    }
+
+    CheckpointHeader previous;
+    if (fileSize < sizeof(previous) || pread(_fd, &previous, sizeof(previous), 0) != static_cast<ssize_t>(sizeof(previous))
+        || memcmp(previous.magic, _header.magic, sizeof(previous.magic)) != 0 || previous.crc != checksum::crc32(&previous, offsetof(CheckpointHeader, crc))) {
+        close(_fd);
+        throw std::runtime_error("Existing file " + _name + " is not a checkpoint or its header is corrupt");
+    }
+    if (previous.key != key) {
+        close(_fd);
+        throw std::runtime_error("Checkpoint " + _name + " was written by a run with different arguments");
+    }
+    _header = previous;
+    readRecords(fileSize);
+}
+
+Checkpoint::~Checkpoint() {
+    if (_fd >= 0) close(_fd);
+}
+
+void Checkpoint::readRecords(size_t fileSize) {
+    /*Read records after the header up to the first that is incomplete, fails its CRC or cannot be parsed, and truncate
+    the file there so that new records follow the last valid one*/
+    size_t position = sizeof(CheckpointHeader);
+    while (fileSize - position >= recordHeaderBytes) {
+        uint32_t type, crc;
+        uint64_t bytes;
+        char recordHeader[recordHeaderBytes];
+        if (pread(_fd, recordHeader, recordHeaderBytes, position) != static_cast<ssize_t>(recordHeaderBytes)) break;
+        memcpy(&type, recordHeader, sizeof(type));
+        memcpy(&crc, recordHeader + 4, sizeof(crc));
+        memcpy(&bytes, recordHeader + 8, sizeof(bytes));
+        if (bytes > fileSize - position - recordHeaderBytes) break;
+        std::string payload(bytes, '\0');
+        if (pread(_fd, &payload[0], bytes, position + recordHeaderBytes) != static_cast<ssize_t>(bytes)) break;
+        if (crc != recordCrc(type, bytes, payload)) break;
+
+        try {
+            PayloadReader reader(payload);
+            size_t config = reader.get<uint64_t>();
+            if (type == sliceRecord) {
+                SliceBlock block;
+                block.first = reader.get<uint64_t>();
+                block.stats.resize(reader.get<uint64_t>());
+                for (RunningStats& stats : block.stats) {
+                    stats.count = reader.get<uint64_t>();
+                    stats.mean = reader.get<double>();
+                    stats.m2 = reader.get<double>();
+                }
+                if (!reader.atEnd()) break;
+                _blocks[config].push_back(block);
+            } else if (type == configRecord) {
+                ConfigRecord record;
+                record.name = reader.getString();
+                record.resultBytes = reader.get<uint64_t>();
+                record.means.resize(reader.get<uint64_t>());
+                for (double& mean : record.means) mean = reader.get<double>();
+                record.rows = reader.getString();
+                if (!reader.atEnd()) break;
+                _configs[config] = record;
+                _blocks.erase(config);
+            } else {
+                break;
+            }
+        } catch (std::runtime_error& e) {
+            break;
+        }
+        position += recordHeaderBytes + bytes;
+    }
+
+    if (position < fileSize) {
+        std::cout << "Discarding " << fileSize - position << " bytes of incomplete or corrupt records at the end of checkpoint " << _name << "\n";
+        if (ftruncate(_fd, position) != 0) throw std::runtime_error("Could not truncate checkpoint file: " + _name);
+    }
+    _size = position;
+}
+
+void Checkpoint::writeRecord(uint32_t type, const std::string& payload) {
+    /*Append record and sync it to disk, so that it survives the process being killed as soon as this returns*/
+    uint64_t bytes = payload.size();
+    uint32_t crc = recordCrc(type, bytes, payload);
+    std::string record;
+    put(record, type);
+    put(record, crc);
+    put(record, bytes);
+    record += payload;
+    if (pwrite(_fd, record.data(), record.size(), _size) != static_cast<ssize_t>(record.size()) || fsync(_fd) != 0) {
+        throw std::runtime_error("Could not write checkpoint file: " + _name);
+    }
+    _size += record.size();
+}
+
+uint64_t Checkpoint::getResultBytes() const {
+    /*Size of the binary result file covering exactly the finished configs. Anything beyond it was appended by a config
+    that did not finish*/
+    uint64_t bytes = _header.resultBytes;
+    for (const auto& config : _configs) bytes = std::max(bytes, config.second.resultBytes);
+    return bytes;
+}
+
+std::vector<SliceBlock> Checkpoint::getBlocks() const {
+    /*Finished timeslice blocks of the current config*/
+    auto blocks = _blocks.find(_config);
+    return (blocks == _blocks.end()) ? std::vector<SliceBlock>() : blocks->second;
+}
+
+void Checkpoint::addBlock(size_t first, const std::vector<RunningStats>& stats) {
+    /*Record statistics of the timeslices of the current config from first*/
+    std::string payload;
+    put<uint64_t>(payload, _config);
+    put<uint64_t>(payload, first);
+    put<uint64_t>(payload, stats.size());
+    for (const RunningStats& entry : stats) {
+        put<uint64_t>(payload, entry.count);
+        put(payload, entry.mean);
+        put(payload, entry.m2);
+    }
+    writeRecord(sliceRecord, payload);
+    _blocks[_config].push_back(SliceBlock{first, stats});
+}
+
+void Checkpoint::addConfig(size_t config, const ConfigRecord& record) {
+    /*Record a config as finished, after its results have been written. Its timeslice blocks are no longer needed*/
+    std::string payload;
+    put<uint64_t>(payload, config);
+    putString(payload, record.name);
+    put(payload, record.resultBytes);
+    put<uint64_t>(payload, record.means.size());
+    for (double mean : record.means) put(payload, mean);
+    putString(payload, record.rows);
+    writeRecord(configRecord, payload);
+    _configs[config] = record;
+    _blocks.erase(config);
+}
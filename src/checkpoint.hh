@@ -0,0 +1,81 @@
+#ifndef CHECKPOINT_HH_
+#define CHECKPOINT_HH_
+
+//C++
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+//POSIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+//Project
+#include "statistics.hh"
+#include "checksum.hh"
+
+struct CheckpointHeader {
+	/*Fixed 32-byte header of a checkpoint file*/
+	char magic[8]; //"LQCDCK01"
+	uint64_t key; //Hash of the arguments of the run
+	uint64_t resultBytes; //Size of the binary result file when the run began
+	uint32_t crc; //CRC of the preceding fields
+	uint32_t padding;
+};
+
+struct SliceBlock {
+	/*Wilson loop statistics of consecutive base timeslices of a config, indexed by (t - first)*nEntries + index(R,T)*/
+	size_t first;
+	std::vector<RunningStats> stats;
+};
+
+struct ConfigRecord {
+	/*Everything needed to reproduce the output of a finished config without measuring it again*/
+	std::string name;
+	uint64_t resultBytes; //Size of the binary result file once the config was appended
+	std::vector<double> means; //Wilson loop means for the jackknife, indexed by index(R,T)
+	std::string rows; //Rows of the combined output file
+};
+
+class Checkpoint {
+	/*Append-only record of the finished work of a run, so that a run restarted with the same arguments after being killed
+	skips it. Records are either blocks of timeslices of the config being measured, or whole configs, and each is
+	written with a CRC and synced to disk before the run moves on. On opening, records are read back until the first
+	incomplete or corrupt one, which with anything after it is discarded*/
+
+private:
+	std::string _name;
+	int _fd;
+	CheckpointHeader _header;
+	size_t _size; //Bytes of header and valid records
+	size_t _config; //Config that new slice blocks belong to
+	std::map<size_t, ConfigRecord> _configs;
+	std::map<size_t, std::vector<SliceBlock>> _blocks;
+
+	void readRecords(size_t);
+	void writeRecord(uint32_t, const std::string&);
+
+public:
+	static constexpr size_t blocksPerConfig = 8;
+
+	Checkpoint(std::string, uint64_t, uint64_t);
+	Checkpoint(const Checkpoint&) = delete;
+	Checkpoint& operator=(const Checkpoint&) = delete;
+	~Checkpoint();
+	std::string getName() const { return _name; }
+	uint64_t getResultBytes() const;
+	const std::map<size_t, ConfigRecord>& getConfigs() const { return _configs; }
+	bool isComplete(size_t config) const { return _configs.count(config) > 0; }
+	void setConfig(size_t config) { _config = config; }
+	std::vector<SliceBlock> getBlocks() const;
+	void addBlock(size_t, const std::vector<RunningStats>&);
+	void addConfig(size_t, const ConfigRecord&);
+};
+
+#endif /* CHECKPOINT_HH_ */
@@ -0,0 +1,36 @@
+#include "checksum.hh"
+
+namespace {
+    struct CrcTable {
+        /*Lookup table of the reflected CRC-32 polynomial, one byte at a time*/
+        uint32_t entries[256];
+
+        CrcTable() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (size_t bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                entries[i] = crc;
+            }
+        }
+    };
+
+    const CrcTable crcTable;
+}
+
+uint32_t checksum::crc32(const void* data, size_t bytes, uint32_t crc) {
+    /*CRC of bytes of data. Passing the CRC of earlier data continues it, so a buffer may be checked in pieces*/
+    const unsigned char* byte = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < bytes; i++) crc = crcTable.entries[(crc ^ byte[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint64_t checksum::hash(const std::string& text) {
+    /*FNV-1a hash of text*/
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,16 @@
+#ifndef CHECKSUM_HH_
+#define CHECKSUM_HH_
+
+//C++
+#include <string>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace checksum {
+	/*Checksums for detecting torn or corrupted files*/
+
+	uint32_t crc32(const void*, size_t, uint32_t crc=0); //IEEE 802.3 CRC, continued from crc
+	uint64_t hash(const std::string&); //64-bit FNV-1a, to identify runs by their arguments
+}
+
+#endif /* CHECKSUM_HH_ */
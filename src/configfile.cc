@@ -0,0 +1,232 @@
+#include "configfile.hh"
+
+static_assert(sizeof(ConfigHeader) == 64, "Configuration file header must be 64 bytes");
+
+namespace {
+    const char magic[8] = {'L', 'Q', 'C', 'D', 'C', 'F', '0', '1'};
+
+    size_t getDataOffset(size_t nT) {
+        /*Start of the first timeslice: after the header and the CRC table, rounded up to a whole cache line*/
+        return ((sizeof(ConfigHeader) + nT*sizeof(uint32_t) + LinkField::alignment - 1)/LinkField::alignment)*LinkField::alignment;
+    }
+
+    bool readHeader(int fd, ConfigHeader& header) {
+        /*Read the header at the start of fd. False if the file is too short or does not start with the magic*/
+        return pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) && memcmp(header.magic, magic, sizeof(magic)) == 0;
+    }
+
+    void checkHeader(const ConfigHeader& header, std::string name) {
+        /*Throw if the header is corrupt or describes a link format this build does not know*/
+        if (header.crc != checksum::crc32(&header, offsetof(ConfigHeader, crc))) throw std::runtime_error("Header of configuration " + name + " fails its checksum");
+        if (header.format > static_cast<uint32_t>(LinkFormat::twoRowSingle) || header.linkBytes != getLinkBytes(static_cast<LinkFormat>(header.format))) {
+            throw std::runtime_error("Configuration " + name + " has an unknown link format");
+        }
+        for (size_t d = 0; d < 4; d++) {
+            if (header.shape[d] == 0) throw std::runtime_error("Configuration " + name + " has an invalid shape");
+        }
+    }
+}
+
+ConfigFile::ConfigFile(std::string name, std::array<size_t, 4> shape) : _name(name), _fd(-1), _native(false), _shape(shape), _format(LinkFormat::full),
+                                                                      _linkBytes(getLinkBytes(LinkFormat::full)), _dataOffset(0) {
+    /*Open configuration and check that it holds a lattice of the given shape. A native file must also have an intact
+    header and the size its header implies, so a truncated file is caught before any link is read*/
+    _fd = open(_name.c_str(), O_RDONLY);
+    if (_fd < 0) throw std::runtime_error("Could not open file: " + _name);
+    try {
+        struct stat info;
+        if (fstat(_fd, &info) != 0) throw std::runtime_error("Could not stat file: " + _name);
+        const size_t fileSize = static_cast<size_t>(info.st_size);
+
+        ConfigHeader header;
+        _native = readHeader(_fd, header);
+        if (!_native) {
+            const size_t expected = _shape[3]*getSliceBytes();
+            if (fileSize != expected) {
+                std::cout << "Configuration " << _name << " holds " << fileSize << " bytes but lattice shape requires " << expected << std::endl;
+                throw std::runtime_error("Configuration size does not match lattice shape");
+            }
+            return;
+        }
+
+        checkHeader(header, _name);
+        std::array<size_t, 4> fileShape = {header.shape[0], header.shape[1], header.shape[2], header.shape[3]};
+        if (fileShape != _shape) {
+            std::cout << "Configuration " << _name << " has shape " << fileShape[0] << "x" << fileShape[1] << "x" << fileShape[2] << "x" << fileShape[3]
+                      << " but lattice shape is " << _shape[0] << "x" << _shape[1] << "x" << _shape[2] << "x" << _shape[3] << std::endl;
+            throw std::runtime_error("Configuration shape does not match lattice shape");
+        }
+        _format = static_cast<LinkFormat>(header.format);
+        _linkBytes = header.linkBytes;
+        _dataOffset = getDataOffset(_shape[3]);
+        if (fileSize != getBytes()) {
+            std::cout << "Configuration " << _name << " holds " << fileSize << " bytes but its header requires " << getBytes() << std::endl;
+            throw std::runtime_error("Configuration size does not match its header");
+        }
+        _sliceCrcs.resize(_shape[3]);
+        readBytes(reinterpret_cast<char*>(_sliceCrcs.data()), _shape[3]*sizeof(uint32_t), sizeof(ConfigHeader));
+    } catch (...) {
+        close(_fd);
+        throw;
+    }
+}
+
+ConfigFile::~ConfigFile() {
+    if (_fd >= 0) close(_fd);
+}
+
+bool ConfigFile::isNativeFile(std::string name) {
+    /*Whether name starts with the magic of a native configuration file*/
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    ConfigHeader header;
+    bool native = readHeader(fd, header);
+    close(fd);
+    return native;
+}
+
+std::array<size_t, 4> ConfigFile::readShape(std::string name) {
+    /*Lattice shape recorded in the header of a native configuration file*/
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Could not open file: " + name);
+    ConfigHeader header;
+    bool native = readHeader(fd, header);
+    close(fd);
+    if (!native) throw std::runtime_error("Configuration " + name + " has no header");
+    checkHeader(header, name);
+    return {header.shape[0], header.shape[1], header.shape[2], header.shape[3]};
+}
+
+void ConfigFile::readBytes(char* target, size_t bytes, size_t offset) const {
+    /*Read bytes from offset, however many calls that takes*/
+    for (size_t done = 0; done < bytes; ) {
+        ssize_t got = pread(_fd, target + done, bytes - done, static_cast<off_t>(offset + done));
+        if (got <= 0) throw std::runtime_error("Could not read configuration: " + _name);
+        done += static_cast<size_t>(got);
+    }
+}
+
+void ConfigFile::readSlice(size_t t, char* target) const {
+    /*Read timeslice t as stored in the file into target, checking it against its CRC*/
+    readBytes(target, getSliceBytes(), _dataOffset + t*getSliceBytes());
+    if (_native && checksum::crc32(target, getSliceBytes()) != _sliceCrcs[t]) {
+        throw std::runtime_error("Timeslice " + std::to_string(t) + " of configuration " + _name + " fails its checksum");
+    }
+}
+
+void ConfigFile::readSlices(size_t first, size_t nSlices, std::complex<double>* target) const {
+    /*Read nSlices timeslices from timeslice first into target as double-precision links in file order*/
+    if (!_native) {
+        readBytes(reinterpret_cast<char*>(target), nSlices*getSliceBytes(), first*getSliceBytes());
+        return;
+    }
+    const size_t sliceLinks = 4*getSpatialVolume();
+    std::vector<char> raw(getSliceBytes());
+    for (size_t s = 0; s < nSlices; s++) {
+        readSlice(first + s, raw.data());
+        for (size_t i = 0; i < sliceLinks; i++) decodeLink(_format, raw.data() + i*_linkBytes, target + (s*sliceLinks + i)*LinkField::linkSize);
+    }
+}
+
+size_t ConfigFile::load(LinkField& links, size_t first, size_t nSlices, size_t slot, bool validate, FixStats* fixes) const {
+    /*Read nSlices timeslices from timeslice first into links from slot onwards, each thread reading, checking and storing
+    whole timeslices. Links are validated as by LinkField::load, within the tolerance of the file's link format. If the file
+    is already in the storage format of links and validation is off, timeslices are read straight into place.
+    Returns the position of the first invalid link counted from timeslice first, or the number of links read if all
+    are valid. Throws if a timeslice cannot be read or fails its CRC*/
+    const size_t sliceLinks = 4*getSpatialVolume();
+    const bool direct = links.getFormat() == _format && !validate;
+    size_t firstInvalid = nSlices*sliceLinks;
+    std::vector<std::string> errors(nSlices);
+
+    #pragma omp parallel reduction(min:firstInvalid)
+    {
+        std::vector<char> raw(direct ? 0 : getSliceBytes());
+        std::vector<std::complex<double>> decoded(direct ? 0 : sliceLinks*LinkField::linkSize);
+        FixStats threadFixes;
+        #pragma omp for schedule(dynamic)
+        for (size_t s = 0; s < nSlices; s++) {
+            try {
+                readSlice(first + s, direct ? links.getSlice(slot + s) : raw.data());
+            } catch (std::exception& e) {
+                errors[s] = e.what();
+                continue;
+            }
+            if (direct) continue;
+            for (size_t i = 0; i < sliceLinks; i++) decodeLink(_format, raw.data() + i*_linkBytes, decoded.data() + i*LinkField::linkSize);
+            size_t invalid = links.load(decoded.data(), slot + s, 1, validate, (fixes != nullptr) ? &threadFixes : nullptr, getLinkTolerance(_format));
+            if (invalid < sliceLinks) firstInvalid = std::min(firstInvalid, s*sliceLinks + invalid);
+        }
+        if (fixes != nullptr) {
+            #pragma omp critical
+            fixes->merge(threadFixes);
+        }
+    }
+
+    for (const std::string& error : errors) {
+        if (error != "") throw std::runtime_error(error);
+    }
+    return firstInvalid;
+}
+
+ConfigWriter::ConfigWriter(std::string name, std::array<size_t, 4> shape, LinkFormat format) : _name(name), _tempName(name + ".tmp"), _fd(-1) {
+    /*Start writing a native configuration of the given shape with links stored in format*/
+    memset(&_header, 0, sizeof(_header));
+    memcpy(_header.magic, magic, sizeof(magic));
+    for (size_t d = 0; d < 4; d++) _header.shape[d] = shape[d];
+    _header.format = static_cast<uint32_t>(format);
+    _header.linkBytes = static_cast<uint32_t>(getLinkBytes(format));
+    _header.crc = checksum::crc32(&_header, offsetof(ConfigHeader, crc));
+    _dataOffset = getDataOffset(shape[3]);
+    _sliceCrcs.assign(shape[3], 0);
+    _written.assign(shape[3], false);
+
+    _fd = open(_tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0) throw std::runtime_error("Could not open file: " + _tempName);
+}
+
+ConfigWriter::~ConfigWriter() {
+    if (_fd >= 0) { //Not finished, so remove the partial file
+        close(_fd);
+        unlink(_tempName.c_str());
+    }
+}
+
+size_t ConfigWriter::getBytes() const {
+    /*Size of the finished file*/
+    return _dataOffset + _header.shape[3]*4*_header.shape[0]*_header.shape[1]*_header.shape[2]*_header.linkBytes;
+}
+
+void ConfigWriter::writeSlice(size_t t, const std::complex<double>* source) {
+    /*Encode timeslice t, given as double-precision links in file order, and write it with its CRC*/
+    if (_fd < 0) throw std::runtime_error("Configuration " + _name + " is already finished");
+    const size_t sliceLinks = 4*_header.shape[0]*_header.shape[1]*_header.shape[2];
+    const LinkFormat format = static_cast<LinkFormat>(_header.format);
+    std::vector<char> raw(sliceLinks*_header.linkBytes);
+    for (size_t i = 0; i < sliceLinks; i++) encodeLink(format, source + i*LinkField::linkSize, raw.data() + i*_header.linkBytes);
+    _sliceCrcs[t] = checksum::crc32(raw.data(), raw.size());
+
+    const size_t offset = _dataOffset + t*raw.size();
+    for (size_t done = 0; done < raw.size(); ) {
+        ssize_t wrote = pwrite(_fd, raw.data() + done, raw.size() - done, static_cast<off_t>(offset + done));
+        if (wrote <= 0) throw std::runtime_error("Could not write configuration: " + _tempName);
+        done += static_cast<size_t>(wrote);
+    }
+    _written[t] = true;
+}
+
+void ConfigWriter::finish() {
+    /*Write the header and CRC table, sync, and move the file to its final name*/
+    if (std::find(_written.begin(), _written.end(), false) != _written.end()) throw std::runtime_error("Not every timeslice of " + _name + " was written");
+    const size_t tableBytes = _sliceCrcs.size()*sizeof(uint32_t);
+    if (pwrite(_fd, &_header, sizeof(_header), 0) != static_cast<ssize_t>(sizeof(_header))
+        || pwrite(_fd, _sliceCrcs.data(), tableBytes, sizeof(_header)) != static_cast<ssize_t>(tableBytes) || fsync(_fd) != 0) {
+        throw std::runtime_error("Could not write configuration: " + _tempName);
+    }
+    close(_fd);
+    _fd = -1;
+    if (rename(_tempName.c_str(), _name.c_str()) != 0) {
+        unlink(_tempName.c_str());
+        throw std::runtime_error("Could not move " + _tempName + " to " + _name);
+    }
+}
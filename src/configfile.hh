@@ -0,0 +1,99 @@
+#ifndef CONFIGFILE_HH_
+#define CONFIGFILE_HH_
+
+//C++
+#include <string>
+#include <vector>
+#include <array>
+#include <complex>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+//POSIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+//OpenMP
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+//Project
+#include "linkfield.hh"
+#include "checksum.hh"
+
+struct ConfigHeader {
+	/*Fixed 64-byte header of a native configuration file. It is followed by the CRC of every timeslice as uint32, then
+	by the timeslices from the first 64-byte boundary after that table. Each timeslice holds the links of its sites in
+	file order, encoded in the header's link format exactly as LinkField stores them in memory*/
+	char magic[8]; //"LQCDCF01"
+	uint64_t shape[4]; //Nx, Ny, Nz, Nt
+	uint32_t format; //LinkFormat: 0 double, 1 tworow, 2 float, 3 tworowfloat
+	uint32_t linkBytes; //Bytes per encoded link
+	uint32_t reserved[3];
+	uint32_t crc; //CRC of the preceding fields
+};
+
+class ConfigFile {
+	/*Configuration file opened for reading by timeslice, in either the legacy layout, headerless (real, imaginary)
+	doubles in file order, or the native layout described by ConfigHeader, which is recognised by its magic.
+	Every timeslice of a native file is checked against its CRC as it is read*/
+
+private:
+	std::string _name;
+	int _fd;
+	bool _native;
+	std::array<size_t, 4> _shape;
+	LinkFormat _format;
+	size_t _linkBytes;
+	size_t _dataOffset;
+	std::vector<uint32_t> _sliceCrcs;
+
+	void readBytes(char*, size_t, size_t) const;
+
+public:
+	ConfigFile(std::string, std::array<size_t, 4>);
+	ConfigFile(const ConfigFile&) = delete;
+	ConfigFile& operator=(const ConfigFile&) = delete;
+	~ConfigFile();
+	static bool isNativeFile(std::string);
+	static std::array<size_t, 4> readShape(std::string);
+	bool isNative() const { return _native; }
+	LinkFormat getFormat() const { return _format; }
+	size_t getSpatialVolume() const { return _shape[0]*_shape[1]*_shape[2]; }
+	size_t getSliceBytes() const { return 4*getSpatialVolume()*_linkBytes; }
+	size_t getBytes() const { return _dataOffset + _shape[3]*getSliceBytes(); }
+	void readSlice(size_t, char*) const;
+	void readSlices(size_t, size_t, std::complex<double>*) const;
+	size_t load(LinkField&, size_t, size_t, size_t, bool, FixStats* fixes=nullptr) const;
+};
+
+class ConfigWriter {
+	/*Native configuration file written one timeslice at a time. The file is built under a temporary name and only
+	renamed into place by finish, once its header and CRC table are complete and synced, so an interrupted conversion
+	never leaves a partial file under the final name*/
+
+private:
+	std::string _name;
+	std::string _tempName;
+	int _fd;
+	ConfigHeader _header;
+	size_t _dataOffset;
+	std::vector<uint32_t> _sliceCrcs;
+	std::vector<bool> _written;
+
+public:
+	ConfigWriter(std::string, std::array<size_t, 4>, LinkFormat);
+	ConfigWriter(const ConfigWriter&) = delete;
+	ConfigWriter& operator=(const ConfigWriter&) = delete;
+	~ConfigWriter();
+	void writeSlice(size_t, const std::complex<double>*);
+	void finish();
+	size_t getBytes() const;
+};
+
+#endif /* CONFIGFILE_HH_ */
@@ -0,0 +1,133 @@
+#include "convert.hh"
+
+std::string defaultInput = "./Data/SU3_24_24_24_48_6.2000_1000_PHB_4_OR_7_dp.bin";
+
+void showHelp() {
+    /*Show help for input arguments*/
+    std::cout << "Convert a configuration between the legacy raw layout and the native layout with header and per-timeslice CRC\n";
+    std::cout << "-i : Input file name, raw or native, default " << defaultInput << "\n";
+    std::cout << "-o : Output file name, required\n";
+    std::cout << "-g : Lattice shape Nx,Ny,Nz,Nt, default read from the header of a native input, else from <input>.shape if present, else from the SU3_Nx_Ny_Nz_Nt_ pattern of the input name\n";
+    std::cout << "-f : Output link format [double/tworow/float/tworowfloat/raw], default tworowfloat. Raw writes the legacy headerless doubles\n";
+    std::cout << "-u : Link validation of the input [check/trust/fix], default check. Fix reunitarises non-unitary links before they are written\n";
+    std::cout << "-p : Per-phase timing summary at exit [off/print/<file>], default off. A file name writes the summary as CSV\n";
+}
+
+std::map<std::string, std::string> getOptions(int argc, char* argv[]) {
+    /*Interpret input arguments*/
+    std::map<std::string, std::string> options;
+    options.insert(std::make_pair("-i", defaultInput)); //Input file
+    options.insert(std::make_pair("-o", "")); //Output file
+    options.insert(std::make_pair("-g", "")); //Lattice shape
+    options.insert(std::make_pair("-f", "tworowfloat")); //Output link format
+    options.insert(std::make_pair("-u", "check")); //Link validation
+    options.insert(std::make_pair("-p", "off")); //Timing summary
+
+    for (int i = 1; i < argc; i = i+2) {
+        std::string option(argv[i]);
+        if (option == "-h" || option == "--help" || i+1 >= argc) { //Check if help was requested
+            options.clear();
+            return options;
+        }
+        options[option] = argv[i+1];
+    }
+    return options;
+}
+
+std::string getPoint(std::array<size_t, 4> shape, size_t site) {
+    /*Format coordinates of site for printing*/
+    std::array<size_t, 4> point;
+    for (size_t d = 0; d < 4; d++) {
+        point[d] = site%shape[d];
+        site /= shape[d];
+    }
+    return "(" + std::to_string(point[0]) + "," + std::to_string(point[1]) + "," + std::to_string(point[2]) + "," + std::to_string(point[3]) + ")";
+}
+
+void validateSlice(std::array<size_t, 4> shape, size_t t, std::complex<double>* links, double tolerance, std::string validation, FixStats& fixes) {
+    /*Check the links of timeslice t, in file order, against SU(3) within tolerance. Under fix, non-unitary links are
+    reunitarised in place, otherwise the first one found is reported and thrown*/
+    const size_t n = LinkField::linkSize;
+    const size_t sliceLinks = 4*shape[0]*shape[1]*shape[2];
+    for (size_t i = 0; i < sliceLinks; i++) {
+        std::complex<double>* link = links + i*n;
+        if (su3::isSpecialUnitary(link, tolerance)) continue;
+        std::complex<double> fixed[n];
+        std::copy(link, link + n, fixed);
+        if (validation == "fix") su3::reunitarise(fixed);
+        if (validation != "fix" || !su3::isSpecialUnitary(fixed)) {
+            size_t site = t*sliceLinks/4 + i/4;
+            std::cout << "Matrix at " << getPoint(shape, site) << " in " << "xyzt"[i%4] << " direction is not unitary\n";
+            std::cout << "Determinant is: " << su3::det(link) << "\n";
+            std::cout << "Largest element of U.U^dagger - 1 is: " << su3::unitarityDeviation(link) << std::endl;
+            throw std::runtime_error("Non-unitary matrix");
+        }
+        fixes.add(link, fixed);
+        std::copy(fixed, fixed + n, link);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::map<std::string, std::string> options = getOptions(argc, argv); //Get parsed arguments
+    if (options.size() == 0) {
+        showHelp();
+        return 1;
+    }
+    timing::Summary summary(options["-p"]);
+    if (options["-o"] == "") throw std::runtime_error("No output file given, pass it with -o");
+    if (options["-u"] != "check" && options["-u"] != "trust" && options["-u"] != "fix") throw std::runtime_error("Unknown link validation: " + options["-u"]);
+    const bool raw = options["-f"] == "raw";
+    const LinkFormat format = raw ? LinkFormat::full : parseLinkFormat(options["-f"]);
+
+    std::array<size_t, 4> shape = getGeometry(options["-g"], options["-i"]);
+    std::cout << "Lattice shape: " << shape[0] << "x" << shape[1] << "x" << shape[2] << "x" << shape[3] << "\n";
+    ConfigFile input(options["-i"], shape);
+    std::cout << "Converting " << options["-i"] << " (" << (input.isNative() ? getLinkFormatName(input.getFormat()) : "raw") << ") to "
+              << options["-o"] << " (" << options["-f"] << ")\n";
+
+    //Raw output goes through a temporary file like native output, so a failed conversion never leaves a partial file
+    std::unique_ptr<ConfigWriter> writer;
+    std::ofstream rawFile;
+    const std::string rawTemp = options["-o"] + ".tmp";
+    if (raw) {
+        rawFile.open(rawTemp, std::ios::binary | std::ios::trunc);
+        if (!rawFile.good()) throw std::runtime_error("Could not open file: " + rawTemp);
+    } else {
+        writer.reset(new ConfigWriter(options["-o"], shape, format));
+    }
+
+    const size_t sliceElements = 4*shape[0]*shape[1]*shape[2]*LinkField::linkSize;
+    const double tolerance = getLinkTolerance(input.getFormat());
+    std::vector<std::complex<double>> slice(sliceElements);
+    FixStats fixes;
+    try {
+        for (size_t t = 0; t < shape[3]; t++) { //Loop over t
+            timing::Timer readTimer(timing::Phase::read);
+            input.readSlices(t, 1, slice.data());
+            readTimer.count({0, static_cast<double>(input.getSliceBytes())});
+            readTimer.stop();
+            if (options["-u"] != "trust") validateSlice(shape, t, slice.data(), tolerance, options["-u"], fixes);
+            timing::Timer writeTimer(timing::Phase::output);
+            if (raw) rawFile.write(reinterpret_cast<const char*>(slice.data()), sliceElements*sizeof(std::complex<double>));
+            else writer->writeSlice(t, slice.data());
+        }
+        if (raw) {
+            rawFile.close();
+            if (rawFile.fail() || rename(rawTemp.c_str(), options["-o"].c_str()) != 0) throw std::runtime_error("Could not write configuration: " + options["-o"]);
+        } else {
+            writer->finish();
+        }
+    } catch (...) {
+        if (raw) remove(rawTemp.c_str());
+        throw;
+    }
+
+    if (fixes.count > 0) {
+        std::cout << "Reunitarised " << fixes.count << " of " << 4*shape[0]*shape[1]*shape[2]*shape[3] << " links: largest deviation from SU(3) "
+                  << fixes.maxDeviation << ", largest element change " << fixes.maxChange << ", mean " << fixes.meanChange() << "\n";
+    }
+    const double rawBytes = shape[3]*sliceElements*sizeof(std::complex<double>);
+    const double bytes = raw ? rawBytes : writer->getBytes();
+    std::cout << "Wrote " << bytes << " bytes, 1/" << rawBytes/bytes << " of the raw size\n";
+    return 0;
+}
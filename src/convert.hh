@@ -0,0 +1,21 @@
+#ifndef CONVERT_HH_
+#define CONVERT_HH_
+//c++
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <complex>
+#include <map>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+//POSIX
+#include <stdio.h>
+//project
+#include "configfile.hh"
+#include "geometry.hh"
+#include "instrument.hh"
+
+#endif /* CONVERT_HH_ */
@@ -0,0 +1,191 @@
+#include "distributedlattice.hh"
+
+DistributedLattice::DistributedLattice(MPI_Comm comm, std::array<size_t, 4> shape, size_t halo,
+                                       std::string verbose, std::string validation, std::string format) {
+    /*Divide the Nt timeslices of shape as evenly as possible between the ranks of comm and allocate this rank's block
+    plus halo timeslices in the given link format. Every rank must hold at least one timeslice*/
+    _comm = comm;
+    MPI_Comm_rank(_comm, &_rank);
+    MPI_Comm_size(_comm, &_nRanks);
+    _shape = shape;
+    _halo = halo;
+    _verbose = tracing::parsePoints(verbose);
+    if (validation != "check" && validation != "trust" && validation != "fix") throw std::runtime_error("Unknown link validation: " + validation);
+    _validation = validation;
+    if (static_cast<size_t>(_nRanks) > _shape[3]) throw std::runtime_error("More ranks than timeslices");
+
+    _firstSlice = getFirstSlice(_rank);
+    _nSlices = getFirstSlice(_rank+1) - _firstSlice;
+    _links.allocate({_shape[0], _shape[1], _shape[2], _nSlices + _halo}, parseLinkFormat(format));
+    if (_links.getSliceBytes() > INT_MAX) throw std::runtime_error("Timeslice too large for a single MPI message");
+
+    if (tracing::enabled(_verbose, tracing::load)) {
+        std::cout << "Rank " << _rank << " holds timeslices " << _firstSlice << " to " << _firstSlice + _nSlices - 1 << " and " << _halo << " halo timeslices\n";
+    }
+}
+
+size_t DistributedLattice::getFirstSlice(int rank) const {
+    /*First timeslice of rank's block, with rank = number of ranks giving Nt*/
+    return (static_cast<size_t>(rank)*_shape[3])/_nRanks;
+}
+
+int DistributedLattice::getOwner(size_t t) const {
+    /*Rank whose block contains timeslice t*/
+    int rank = static_cast<int>((t*_nRanks)/_shape[3]);
+    while (getFirstSlice(rank+1) <= t) rank++;
+    while (getFirstSlice(rank) > t) rank--;
+    return rank;
+}
+
+std::string DistributedLattice::getPoint(size_t site) const {
+    /*Format coordinates of global site for printing*/
+    std::array<size_t, 4> point;
+    for (size_t d = 0; d < 4; d++) {
+        point[d] = site%_shape[d];
+        site /= _shape[d];
+    }
+    return "(" + std::to_string(point[0]) + "," + std::to_string(point[1]) + "," + std::to_string(point[2]) + "," + std::to_string(point[3]) + ")";
+}
+
+void DistributedLattice::readConfig(std::string configName) {
+    /*Read and validate this rank's block of timeslices from a window of the configuration file, then fill the halo
+    from the neighbouring ranks. A native file is read by timeslice, each checked against its CRC. All ranks throw
+    together if the file or any link is bad*/
+    if (verbose(tracing::load) && _rank == 0) std::cout << "Reading configuration from: " << configName << "\n";
+    const size_t spatialVolume = _links.getSpatialVolume();
+    const unsigned long long nLinks = 4*spatialVolume*_shape[3];
+    FixStats fixes;
+    size_t localInvalid = ConfigFile::isNativeFile(configName) ? readNativeBlock(configName, fixes) : readRawBlock(configName, fixes);
+    unsigned long long firstInvalid = nLinks;
+    if (localInvalid < 4*spatialVolume*_nSlices) firstInvalid = 4*spatialVolume*_firstSlice + localInvalid;
+    MPI_Allreduce(MPI_IN_PLACE, &firstInvalid, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, _comm);
+
+    if (_validation == "fix") {
+        unsigned long long count = fixes.count;
+        double maxima[2] = {fixes.maxDeviation, fixes.maxChange};
+        MPI_Allreduce(MPI_IN_PLACE, &count, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, _comm);
+        MPI_Allreduce(MPI_IN_PLACE, maxima, 2, MPI_DOUBLE, MPI_MAX, _comm);
+        MPI_Allreduce(MPI_IN_PLACE, &fixes.sumChange, 1, MPI_DOUBLE, MPI_SUM, _comm);
+        if (count > 0 && _rank == 0) {
+            std::cout << "Reunitarised " << count << " of " << nLinks << " links in " << configName << ": largest deviation from SU(3) "
+                      << maxima[0] << ", largest element change " << maxima[1] << ", mean " << fixes.sumChange/count << "\n";
+        }
+    }
+
+    if (firstInvalid < nLinks) {
+        size_t site = firstInvalid/4, d = firstInvalid%4;
+        if (getOwner(site/spatialVolume) == _rank) {
+            std::complex<double> scratch[LinkField::linkSize];
+            const std::complex<double>* link = _links.fetch(site - spatialVolume*_firstSlice, d, scratch);
+            std::complex<double> det = su3::det(link);
+            std::cout << "Matrix at " << getPoint(site) << " in " << "xyzt"[d] << " direction is not unitary\n";
+            std::cout << "Determinant is: " << det << "\n";
+            std::cout << "Largest element of U.U^dagger - 1 is: " << su3::unitarityDeviation(link) << std::endl;
+        }
+        throw std::runtime_error("Non-unitary matrix");
+    }
+
+    exchangeHalo();
+}
+
+size_t DistributedLattice::readRawBlock(std::string configName, FixStats& fixes) {
+    /*Map this rank's block of a legacy configuration file and store it. Returns the position of the first invalid link
+    in the block, as LinkField::load*/
+    const size_t sliceFileBytes = 4*_links.getSpatialVolume()*LinkField::linkSize*sizeof(std::complex<double>);
+    timing::Timer readTimer(timing::Phase::read);
+    MappedFile file(configName, _firstSlice*sliceFileBytes, _nSlices*sliceFileBytes);
+    const size_t expected = _shape[3]*sliceFileBytes;
+    if (file.fileSize() != expected) {
+        if (_rank == 0) std::cout << "Configuration " << configName << " holds " << file.fileSize() << " bytes but lattice shape requires " << expected << std::endl;
+        throw std::runtime_error("Configuration size does not match lattice shape");
+    }
+    readTimer.stop();
+
+    const std::complex<double>* source = reinterpret_cast<const std::complex<double>*>(file.data());
+    timing::Timer loadTimer(timing::Phase::load);
+    size_t localInvalid = _links.load(source, 0, _nSlices, _validation != "trust", (_validation == "fix") ? &fixes : nullptr);
+    loadTimer.count({0, static_cast<double>(file.size() + _nSlices*_links.getSliceBytes())});
+    return localInvalid;
+}
+
+size_t DistributedLattice::readNativeBlock(std::string configName, FixStats& fixes) {
+    /*Read this rank's block of a native configuration file. Every rank sees the same header, so a bad header or size
+    throws on all of them, but a timeslice failing its CRC is only seen by its owner and is shared before throwing*/
+    timing::Timer readTimer(timing::Phase::read);
+    ConfigFile file(configName, _shape);
+    readTimer.stop();
+
+    timing::Timer loadTimer(timing::Phase::load);
+    size_t localInvalid = 0;
+    int failed = 0;
+    try {
+        localInvalid = file.load(_links, _firstSlice, _nSlices, 0, _validation != "trust", (_validation == "fix") ? &fixes : nullptr);
+    } catch (std::exception& e) {
+        std::cout << "Rank " << _rank << ": " << e.what() << std::endl;
+        failed = 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_MAX, _comm);
+    if (failed) throw std::runtime_error("Could not read configuration: " + configName);
+    loadTimer.count({0, static_cast<double>(_nSlices*(file.getSliceBytes() + _links.getSliceBytes()))});
+    return localInvalid;
+}
+
+void DistributedLattice::exchangeHalo() {
+    /*Copy the halo timeslices that follow each rank's block from their owners. With periodic boundaries the halo of the
+    last rank wraps round to the first, and a deep halo may span several ranks or this rank's own block.
+    Timeslices are sent in their storage format, with the halo index as the message tag*/
+    const size_t sliceBytes = _links.getSliceBytes();
+    std::vector<MPI_Request> requests;
+    timing::Timer timer(timing::Phase::halo);
+    timer.count({0, static_cast<double>(_halo*sliceBytes)});
+
+    for (size_t h = 0; h < _halo; h++) { //Receive halo timeslices
+        size_t t = (_firstSlice + _nSlices + h)%_shape[3];
+        int owner = getOwner(t);
+        if (owner == _rank) {
+            memcpy(_links.getSlice(_nSlices + h), _links.getSlice(t - _firstSlice), sliceBytes);
+        } else {
+            requests.emplace_back();
+            MPI_Irecv(_links.getSlice(_nSlices + h), static_cast<int>(sliceBytes), MPI_BYTE, owner, static_cast<int>(h), _comm, &requests.back());
+        }
+    }
+
+    for (int rank = 0; rank < _nRanks; rank++) { //Send own timeslices to every rank whose halo includes them
+        if (rank == _rank) continue;
+        for (size_t h = 0; h < _halo; h++) {
+            size_t t = (getFirstSlice(rank+1) + h)%_shape[3];
+            if (getOwner(t) != _rank) continue;
+            requests.emplace_back();
+            MPI_Isend(_links.getSlice(t - _firstSlice), static_cast<int>(sliceBytes), MPI_BYTE, rank, static_cast<int>(h), _comm, &requests.back());
+        }
+    }
+
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+}
+
+std::vector<RunningStats> DistributedLattice::calcWilsonLoopTable(size_t maxR, size_t maxT) {
+    /*Mean, variance and count of Wilson loops for every (R,T) up to (maxR,maxT) over the whole lattice, indexed by R*(maxT+1) + T,
+    returned on rank 0 only. Per-timeslice statistics are gathered rather than reduced, so that rank 0 merges them in the
+    same order as a single process and the results are identical for any number of ranks*/
+    if (maxT > _halo) throw std::runtime_error("Wilson loop extent T = " + std::to_string(maxT) + " exceeds halo depth " + std::to_string(_halo));
+    WilsonEngine engine(_links, maxR, maxT);
+    timing::Timer timer(timing::Phase::wilsonTable);
+    std::vector<RunningStats> sliceStats = engine.calcSliceStats(_nSlices);
+    timer.count(engine.getWork(_nSlices));
+    timer.stop();
+
+    const size_t entryBytes = engine.getEntries()*sizeof(RunningStats); //Sent as bytes, ranks share one architecture
+    std::vector<int> counts(_nRanks), offsets(_nRanks);
+    for (int rank = 0; rank < _nRanks; rank++) {
+        offsets[rank] = static_cast<int>(getFirstSlice(rank)*entryBytes);
+        counts[rank] = static_cast<int>((getFirstSlice(rank+1) - getFirstSlice(rank))*entryBytes);
+    }
+    std::vector<RunningStats> allStats(_rank == 0 ? _shape[3]*engine.getEntries() : 0);
+    timing::Timer gatherTimer(timing::Phase::gather);
+    MPI_Gatherv(sliceStats.data(), static_cast<int>(sliceStats.size()*sizeof(RunningStats)), MPI_BYTE,
+                allStats.data(), counts.data(), offsets.data(), MPI_BYTE, 0, _comm);
+    gatherTimer.stop();
+
+    if (_rank != 0) return std::vector<RunningStats>();
+    return engine.combineSliceStats(allStats);
+}
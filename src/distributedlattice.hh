@@ -0,0 +1,57 @@
+#ifndef DISTRIBUTEDLATTICE_HH_
+#define DISTRIBUTEDLATTICE_HH_
+
+//C++
+#include <string>
+#include <iostream>
+#include <vector>
+#include <array>
+#include <complex>
+#include <stdexcept>
+#include <limits.h>
+#include <string.h>
+//MPI
+#include <mpi.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "wilsonengine.hh"
+#include "mappedfile.hh"
+#include "configfile.hh"
+#include "instrument.hh"
+
+class DistributedLattice {
+	/*One rank's share of a configuration split across MPI processes in blocks of whole timeslices.
+	Each rank holds its own block followed by a halo of the next few timeslices, copied from the ranks that own them,
+	so that every Wilson loop based in the block with T up to the halo depth can be measured locally.
+	Spatial directions are not split, so R is limited only by the spatial extent and no spatial halo is needed*/
+
+private:
+	MPI_Comm _comm;
+	int _rank, _nRanks;
+	std::array<size_t, 4> _shape;
+	size_t _halo;
+	size_t _firstSlice, _nSlices;
+	LinkField _links;
+	uint32_t _verbose;
+	std::string _validation;
+
+	size_t getFirstSlice(int) const;
+	int getOwner(size_t) const;
+	std::string getPoint(size_t) const;
+	void exchangeHalo();
+	size_t readRawBlock(std::string, FixStats&);
+	size_t readNativeBlock(std::string, FixStats&);
+	bool verbose(tracing::Point point) const { return tracing::enabled(_verbose, point); }
+
+public:
+	DistributedLattice(MPI_Comm, std::array<size_t, 4>, size_t, std::string, std::string, std::string);
+	int getRank() const { return _rank; }
+	size_t getFirstSlice() const { return _firstSlice; }
+	size_t getSlices() const { return _nSlices; }
+	const LinkField& getLinks() const { return _links; }
+	void readConfig(std::string);
+	std::vector<RunningStats> calcWilsonLoopTable(size_t, size_t);
+};
+
+#endif /* DISTRIBUTEDLATTICE_HH_ */
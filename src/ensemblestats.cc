@@ -0,0 +1,59 @@
+#include "ensemblestats.hh"
+
+static std::pair<double, double> jackknife(const std::vector<double>& samples) {
+    /*Mean and error of leave-one-out samples*/
+    const double n = static_cast<double>(samples.size());
+    double mean = 0, spread = 0;
+    for (double s : samples) mean += s;
+    mean /= n;
+    for (double s : samples) spread += (s - mean)*(s - mean);
+    return std::make_pair(mean, std::sqrt(spread*(n-1)/n));
+}
+
+EnsembleStats::EnsembleStats(size_t maxR, size_t maxT) : _maxR(maxR), _maxT(maxT) { }
+
+void EnsembleStats::add(const std::vector<double>& means) {
+    /*Store mean Wilson loops of one config, indexed by index(R,T)*/
+    if (means.size() != (_maxR+1)*(_maxT+1)) throw std::runtime_error("Wilson loop table does not match ensemble (R,T) range");
+    _configs.push_back(means);
+}
+
+std::vector<JackknifeEstimate> EnsembleStats::calcJackknife(size_t blockSize) const {
+    /*Jackknife estimates for every (R,T), indexed by index(R,T), over blocks of blockSize consecutive configs.
+    Configs beyond the last whole block are left out. Each (R,T) is resampled independently, in parallel*/
+    const size_t nBlocks = (blockSize > 0) ? _configs.size()/blockSize : 0;
+    if (nBlocks < 2) throw std::runtime_error("Jackknife needs at least two blocks of configs");
+    const size_t nEntries = (_maxR+1)*(_maxT+1);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    //Block means and their totals
+    std::vector<double> blocks(nBlocks*nEntries, 0.), totals(nEntries, 0.);
+    for (size_t b = 0; b < nBlocks; b++) {
+        for (size_t c = b*blockSize; c < (b+1)*blockSize; c++) {
+            for (size_t e = 0; e < nEntries; e++) blocks[b*nEntries + e] += _configs[c][e]/blockSize;
+        }
+        for (size_t e = 0; e < nEntries; e++) totals[e] += blocks[b*nEntries + e];
+    }
+
+    std::vector<JackknifeEstimate> estimates(nEntries, JackknifeEstimate{1., 0., nan, nan});
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t e = 0; e < nEntries; e++) { //Loop over (R,T)
+        const size_t R = e/(_maxT+1), T = e%(_maxT+1);
+        if (R == 0 || T == 0) continue;
+        std::vector<double> samplesW(nBlocks), samplesV(nBlocks);
+        for (size_t b = 0; b < nBlocks; b++) { //Leave out block b
+            samplesW[b] = (totals[e] - blocks[b*nEntries + e])/(nBlocks-1);
+            if (T < _maxT) samplesV[b] = std::log(samplesW[b]/((totals[e+1] - blocks[b*nEntries + e+1])/(nBlocks-1)));
+        }
+
+        std::pair<double, double> w = jackknife(samplesW);
+        estimates[e].meanW = w.first;
+        estimates[e].errorW = w.second;
+        if (T < _maxT) {
+            std::pair<double, double> v = jackknife(samplesV);
+            estimates[e].meanV = v.first;
+            estimates[e].errorV = v.second;
+        }
+    }
+    return estimates;
+}
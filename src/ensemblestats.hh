@@ -0,0 +1,36 @@
+#ifndef ENSEMBLESTATS_HH_
+#define ENSEMBLESTATS_HH_
+
+//C++
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <stdlib.h>
+
+struct JackknifeEstimate {
+	/*Jackknife mean and error of the Wilson loop and of the effective potential at one (R,T)*/
+	double meanW, errorW;
+	double meanV, errorV; //NaN for T = maxT, where W(R,T+1) was not measured
+};
+
+class EnsembleStats {
+	/*Per-config mean Wilson loops of an ensemble, kept in memory for resampling once every config has been measured.
+	Configs are averaged in consecutive blocks to reduce autocorrelation, then jackknifed over blocks.
+	The effective potential V(R,T) = ln(W(R,T)/W(R,T+1)) is evaluated on each jackknife sample of W rather than per config,
+	so that it is never taken of a single noisy W*/
+
+private:
+	size_t _maxR, _maxT;
+	std::vector<std::vector<double>> _configs;
+
+public:
+	EnsembleStats(size_t, size_t);
+	size_t index(size_t R, size_t T) const { return R*(_maxT+1) + T; }
+	size_t getConfigs() const { return _configs.size(); }
+	void add(const std::vector<double>&);
+	std::vector<JackknifeEstimate> calcJackknife(size_t) const;
+};
+
+#endif /* ENSEMBLESTATS_HH_ */
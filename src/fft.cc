@@ -0,0 +1,74 @@
+#include "fft.hh"
+
+namespace fft {
+
+static size_t smallestFactor(size_t n) {
+    /*Smallest prime factor of n > 1*/
+    for (size_t p = 2; p*p <= n; p++) {
+        if (n%p == 0) return p;
+    }
+    return n;
+}
+
+static void recurse(const cplx* in, size_t stride, cplx* out, size_t n, const cplx* roots, size_t rootStride, cplx* buffer) {
+    /*Decimation-in-time step: transform the p interleaved subsequences of length m = n/p into consecutive blocks of out,
+    then combine them with p-point DFTs. roots holds exp(sign 2 pi i j/N) for the full length N = n*rootStride*/
+    if (n == 1) {
+        out[0] = in[0];
+        return;
+    }
+    const size_t p = smallestFactor(n);
+    const size_t m = n/p;
+    for (size_t q = 0; q < p; q++) recurse(in + q*stride, stride*p, out + q*m, m, roots, rootStride*p, buffer);
+
+    for (size_t k = 0; k < m; k++) {
+        for (size_t q = 0; q < p; q++) buffer[q] = out[q*m + k]*roots[((q*k)%n)*rootStride]; //Twiddle
+        for (size_t s = 0; s < p; s++) {
+            cplx sum = buffer[0];
+            for (size_t q = 1; q < p; q++) sum += buffer[q]*roots[((q*s)%p)*m*rootStride];
+            out[k + s*m] = sum;
+        }
+    }
+}
+
+static std::vector<cplx> getRoots(size_t n, int sign) {
+    /*Roots of unity exp(sign 2 pi i j/n)*/
+    std::vector<cplx> roots(n);
+    for (size_t j = 0; j < n; j++) roots[j] = std::polar(1., sign*2.*M_PI*j/n);
+    return roots;
+}
+
+void transform(cplx* data, size_t n, int sign) {
+    /*In-place transform of n contiguous elements*/
+    std::vector<cplx> roots = getRoots(n, sign);
+    std::vector<cplx> input(data, data + n), buffer(n);
+    recurse(input.data(), 1, data, n, roots.data(), 1, buffer.data());
+}
+
+void transform3d(cplx* data, std::array<size_t, 3> shape, int sign) {
+    /*In-place transform of a 3D array with shape[0] the fastest-running index, one axis at a time.
+    The lines along each axis are transformed in parallel*/
+    const size_t volume = shape[0]*shape[1]*shape[2];
+    size_t stride = 1;
+    for (size_t axis = 0; axis < 3; axis++) {
+        const size_t n = shape[axis];
+        const size_t nLines = volume/n;
+        std::vector<cplx> roots = getRoots(n, sign);
+
+        #pragma omp parallel
+        {
+            std::vector<cplx> line(n), result(n), buffer(n);
+
+            #pragma omp for schedule(static)
+            for (size_t l = 0; l < nLines; l++) { //Loop over lines along axis
+                const size_t start = (l/stride)*stride*n + l%stride;
+                for (size_t j = 0; j < n; j++) line[j] = data[start + j*stride];
+                recurse(line.data(), 1, result.data(), n, roots.data(), 1, buffer.data());
+                for (size_t j = 0; j < n; j++) data[start + j*stride] = result[j];
+            }
+        }
+        stride *= n;
+    }
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef FFT_HH_
+#define FFT_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <stdlib.h>
+
+namespace fft {
+	/*Mixed-radix Cooley-Tukey fast Fourier transforms for the small, non power-of-two extents of lattices (e.g. 24 or 48).
+	Each extent is split into its prime factors, so the cost is O(N sum p) for N = p1*p2*..., which is O(N log N) for
+	extents with small factors. Transforms are unnormalised: sign -1 is the forward transform X(k) = sum_x x(x) exp(-2 pi i k x/N)
+	and sign +1 the inverse without the 1/N*/
+
+	typedef std::complex<double> cplx;
+
+	void transform(cplx*, size_t, int);
+	void transform3d(cplx*, std::array<size_t, 3>, int);
+}
+
+#endif /* FFT_HH_ */
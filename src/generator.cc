@@ -0,0 +1,65 @@
+#include "generator.hh"
+
+ConfigGenerator::ConfigGenerator(std::array<size_t, 4> shape, std::string start, uint64_t seed) {
+    /*Start is hot, cold or the spread of a near-unit start*/
+    _shape = shape;
+    _seed = seed;
+    if (start == "hot") _spread = -1;
+    else if (start == "cold") _spread = 0;
+    else {
+        char* end;
+        _spread = strtod(start.c_str(), &end);
+        if (start.empty() || *end != '\0' || _spread < 0) throw std::runtime_error("Unknown start: " + start);
+    }
+}
+
+void ConfigGenerator::generateLink(std::mt19937_64& generator, std::complex<double>* link) const {
+    /*Draw one link. Gram-Schmidt of a matrix of normal complex elements is Haar distributed*/
+    std::normal_distribution<double> gaus;
+    if (_spread == 0) {
+        su3::setIdentity(link);
+        return;
+    }
+    for (size_t i = 0; i < 9; i++) link[i] = std::complex<double>{gaus(generator), gaus(generator)};
+    if (_spread > 0) {
+        for (size_t i = 0; i < 9; i++) link[i] = ((i%4 == 0) ? 1.0 : 0.0) + _spread*link[i];
+    }
+    su3::reunitarise(link);
+}
+
+void ConfigGenerator::generateSlice(size_t t, std::complex<double>* out) const {
+    /*Fill out with the links of timeslice t in file order, generating the z planes in parallel*/
+    const size_t planeSites = _shape[0]*_shape[1];
+    const size_t siteElements = 4*LinkField::linkSize;
+
+    #pragma omp parallel for schedule(static)
+    for (size_t z = 0; z < _shape[2]; z++) { //Loop over z
+        std::seed_seq sequence{static_cast<uint32_t>(_seed), static_cast<uint32_t>(_seed >> 32),
+                               static_cast<uint32_t>(z), static_cast<uint32_t>(t)};
+        std::mt19937_64 generator(sequence);
+        std::complex<double>* plane = out + z*planeSites*siteElements;
+        for (size_t i = 0; i < 4*planeSites; i++) generateLink(generator, plane + i*LinkField::linkSize);
+    }
+}
+
+void ConfigGenerator::fill(LinkField& links) const {
+    /*Generate configuration in memory, one timeslice at a time in the format of links*/
+    if (links.getShape() != _shape) throw std::runtime_error("Link field shape does not match generator");
+    std::vector<std::complex<double>> slice(4*LinkField::linkSize*links.getSpatialVolume());
+    for (size_t t = 0; t < _shape[3]; t++) { //Loop over t
+        generateSlice(t, slice.data());
+        links.load(slice.data(), t, 1, false);
+    }
+}
+
+void ConfigGenerator::write(std::string name) const {
+    /*Write configuration in the on-disk format read by Lattice::readConfig, one timeslice at a time*/
+    std::ofstream outFile(name, std::ios::binary | std::ios::trunc);
+    if (!outFile) throw std::runtime_error("Cannot open configuration file " + name);
+    std::vector<std::complex<double>> slice(4*LinkField::linkSize*_shape[0]*_shape[1]*_shape[2]);
+    for (size_t t = 0; t < _shape[3]; t++) { //Loop over t
+        generateSlice(t, slice.data());
+        outFile.write(reinterpret_cast<const char*>(slice.data()), slice.size()*sizeof(std::complex<double>));
+    }
+    if (!outFile) throw std::runtime_error("Failed writing configuration file " + name);
+}
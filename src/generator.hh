@@ -0,0 +1,40 @@
+#ifndef GENERATOR_HH_
+#define GENERATOR_HH_
+
+//C++
+#include <array>
+#include <complex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <stdlib.h>
+#include <stdint.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+
+class ConfigGenerator {
+	/*Reproducible synthetic SU(3) configurations of any shape, for benchmarking and testing without data files.
+	A hot start draws every link from the Haar measure, a cold start sets every link to the identity and a near-unit
+	start projects 1 + spread*G onto SU(3), where G has independent unit normal complex elements.
+	Each (z, t) plane of links has its own generator seeded from (seed, z, t), so a config is the same whether it is
+	generated in memory or on disk, in any format and with any number of threads*/
+
+private:
+	std::array<size_t, 4> _shape;
+	double _spread; //Negative for a hot start
+	uint64_t _seed;
+
+	void generateLink(std::mt19937_64&, std::complex<double>*) const;
+
+public:
+	ConfigGenerator(std::array<size_t, 4>, std::string, uint64_t);
+	std::array<size_t, 4> getShape() const { return _shape; }
+	void generateSlice(size_t, std::complex<double>*) const;
+	void fill(LinkField&) const;
+	void write(std::string) const;
+};
+
+#endif /* GENERATOR_HH_ */
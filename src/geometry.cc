@@ -0,0 +1,43 @@
+#include "geometry.hh"
+
+std::array<size_t, 4> parseShape(std::string text) {
+    /*Read four extents separated by commas, underscores, 'x' or whitespace*/
+    for (char& c : text) {
+        if (c == ',' || c == '_' || c == 'x') c = ' ';
+    }
+    std::stringstream stream(text);
+    std::array<size_t, 4> shape;
+    for (size_t d = 0; d < 4; d++) {
+        if (!(stream >> shape[d]) || shape[d] == 0) throw std::runtime_error("Invalid lattice shape: " + text);
+    }
+    return shape;
+}
+
+std::array<size_t, 4> getGeometry(std::string option, std::string input) {
+    /*Lattice shape from the -g option, the header of a native input file, a sidecar <input>.shape file, or the
+    SU3_Nx_Ny_Nz_Nt_ pattern of the input name*/
+    if (option != "") return parseShape(option);
+    if (ConfigFile::isNativeFile(input)) return ConfigFile::readShape(input);
+
+    std::ifstream sidecar(input + ".shape");
+    if (sidecar.good()) {
+        std::string text((std::istreambuf_iterator<char>(sidecar)), std::istreambuf_iterator<char>());
+        return parseShape(text);
+    }
+
+    std::string name = input.substr(input.find_last_of('/') + 1);
+    size_t start = name.find("SU3_");
+    if (start != std::string::npos) {
+        std::stringstream stream(name.substr(start + 4));
+        std::array<size_t, 4> shape;
+        bool valid = true;
+        for (size_t d = 0; d < 4; d++) {
+            std::string field;
+            std::getline(stream, field, '_');
+            valid &= field != "" && field.find_first_not_of("0123456789") == std::string::npos;
+            if (valid) shape[d] = std::stoul(field);
+        }
+        if (valid) return shape;
+    }
+    throw std::runtime_error("Could not determine lattice shape of " + input + ", pass it with -g");
+}
@@ -0,0 +1,82 @@
+#ifndef GEOMETRY_HH_
+#define GEOMETRY_HH_
+
+//C++
+#include <array>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <stdexcept>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "configfile.hh"
+
+std::array<size_t, 4> parseShape(std::string);
+std::array<size_t, 4> getGeometry(std::string, std::string);
+
+template <class Links>
+class RuntimeGeometry {
+	/*Neighbour lookup for any lattice shape through the tables held by the link storage*/
+
+private:
+	const Links& _links;
+
+public:
+	RuntimeGeometry(const Links& links) : _links(links) { }
+	size_t next(size_t site, size_t dir) const { return _links.next(site, dir); }
+	size_t prev(size_t site, size_t dir) const { return _links.prev(site, dir); }
+};
+
+template <size_t NX, size_t NY, size_t NZ, size_t NT>
+class FixedGeometry {
+	/*Neighbour lookup for a shape known at compile time. Strides and periodic wrap are constants, so moving
+	reduces to a compare and an add without touching the neighbour tables*/
+
+private:
+	template <size_t STRIDE, size_t EXTENT>
+	static size_t step(size_t site) { return ((site/STRIDE)%EXTENT == EXTENT-1) ? site - (EXTENT-1)*STRIDE : site + STRIDE; }
+	template <size_t STRIDE, size_t EXTENT>
+	static size_t stepBack(size_t site) { return ((site/STRIDE)%EXTENT == 0) ? site + (EXTENT-1)*STRIDE : site - STRIDE; }
+
+public:
+	static constexpr std::array<size_t, 4> shape = {NX, NY, NZ, NT};
+
+	template <class Links>
+	FixedGeometry(const Links&) { }
+
+	size_t next(size_t site, size_t dir) const {
+		switch (dir) {
+			case 0: return step<1, NX>(site);
+			case 1: return step<NX, NY>(site);
+			case 2: return step<NX*NY, NZ>(site);
+			default: return step<NX*NY*NZ, NT>(site);
+		}
+	}
+
+	size_t prev(size_t site, size_t dir) const {
+		switch (dir) {
+			case 0: return stepBack<1, NX>(site);
+			case 1: return stepBack<NX, NY>(site);
+			case 2: return stepBack<NX*NY, NZ>(site);
+			default: return stepBack<NX*NY*NZ, NT>(site);
+		}
+	}
+};
+
+template <size_t NX, size_t NY, size_t NZ, size_t NT>
+constexpr std::array<size_t, 4> FixedGeometry<NX, NY, NZ, NT>::shape;
+
+template <class Links, class Engine>
+auto dispatchGeometry(const Links& links, Engine&& engine) {
+	/*Call engine(geometry) with a compile-time geometry if the lattice has one of the common shapes, or the
+	table-driven runtime geometry otherwise. Links is a LinkField or any storage with the same getShape, next and prev*/
+	std::array<size_t, 4> shape = links.getShape();
+	if (shape == FixedGeometry<16, 16, 16, 32>::shape) return engine(FixedGeometry<16, 16, 16, 32>(links));
+	if (shape == FixedGeometry<24, 24, 24, 48>::shape) return engine(FixedGeometry<24, 24, 24, 48>(links));
+	if (shape == FixedGeometry<32, 32, 32, 64>::shape) return engine(FixedGeometry<32, 32, 32, 64>(links));
+	return engine(RuntimeGeometry<Links>(links));
+}
+
+#endif /* GEOMETRY_HH_ */
@@ -0,0 +1,97 @@
+#include "instrument.hh"
+
+namespace tracing {
+
+uint32_t parsePoints(std::string points) {
+    /*Mask of the comma-separated point names. Other names set no bits, so that any string still only turns on
+    progress output of the main program*/
+    static const std::pair<const char*, Point> names[] = {
+        {"load", load}, {"movePoint", movePoint}, {"calcPlaquette", calcPlaquette}, {"calcMeanPlaquette", calcMeanPlaquette},
+        {"getOverallPlaquetteMean", getOverallPlaquetteMean}, {"calcWilsonLoop", calcWilsonLoop},
+        {"calcMeanWilsonLoopAtPoint", calcMeanWilsonLoopAtPoint}, {"calcOverallMeanWilsonLoop", calcOverallMeanWilsonLoop},
+        {"getWilsonLoopSample", getWilsonLoopSample}, {"calcWilsonLoopTable", calcWilsonLoopTable},
+        {"fixTemporalGauge", fixTemporalGauge}, {"calcPolyakovLoopCorrelator", calcPolyakovLoopCorrelator},
+        {"calcPathStats", calcPathStats}, {"calcPlaquetteStats", calcPlaquetteStats}, {"smearLinks", smearLinks}};
+    uint32_t mask = 0;
+    std::stringstream stream(points);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        for (const auto& entry : names) {
+            if (name == entry.first) mask |= entry.second;
+        }
+    }
+    return mask;
+}
+
+}
+
+namespace timing {
+
+static std::mutex totalsMutex;
+static PhaseTotals totals[static_cast<size_t>(Phase::count)];
+static const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+std::string getPhaseName(Phase phase) {
+    /*Name of phase for reports*/
+    static const char* names[] = {"read", "load", "loadWait", "generate", "gauge", "smear", "plaquette", "wilsonLoop", "wilsonTable",
+                                  "polyakov", "paths", "halo", "gather", "output"};
+    return names[static_cast<size_t>(phase)];
+}
+
+void record(Phase phase, double seconds, Work work) {
+    /*Add one call of phase. Safe to call from the background loader*/
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    PhaseTotals& total = totals[static_cast<size_t>(phase)];
+    total.calls++;
+    total.seconds += seconds;
+    total.multiplies += work.multiplies;
+    total.bytes += work.bytes;
+}
+
+PhaseTotals getTotals(Phase phase) {
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    return totals[static_cast<size_t>(phase)];
+}
+
+void report(std::ostream& out) {
+    /*Table of phases that were called, with rates of counted work*/
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - processStart;
+    out << "\nPhase summary after " << elapsed.count() << " s\n";
+    out << std::left << std::setw(12) << "Phase" << std::right << std::setw(8) << "Calls" << std::setw(12) << "Seconds"
+        << std::setw(8) << "%" << std::setw(14) << "Multiplies" << std::setw(12) << "Mmul/s" << std::setw(12) << "MB" << std::setw(10) << "GB/s" << "\n";
+    for (size_t p = 0; p < static_cast<size_t>(Phase::count); p++) {
+        PhaseTotals total = getTotals(static_cast<Phase>(p));
+        if (total.calls == 0) continue;
+        out << std::left << std::setw(12) << getPhaseName(static_cast<Phase>(p)) << std::right << std::setw(8) << total.calls
+            << std::setw(12) << std::setprecision(4) << total.seconds << std::setw(8) << std::setprecision(3) << 100*total.seconds/elapsed.count()
+            << std::setw(14) << std::setprecision(4) << total.multiplies << std::setw(12) << total.multiplies/total.seconds/1e6
+            << std::setw(12) << total.bytes/1e6 << std::setw(10) << total.bytes/total.seconds/1e9 << "\n";
+    }
+}
+
+void dump(std::string name) {
+    /*Totals of every phase as CSV*/
+    std::ofstream outFile(name);
+    if (!outFile) throw std::runtime_error("Cannot open timing summary file " + name);
+    outFile.precision(17);
+    outFile << "Phase,Calls,Seconds,Multiplies,Bytes\n";
+    for (size_t p = 0; p < static_cast<size_t>(Phase::count); p++) {
+        PhaseTotals total = getTotals(static_cast<Phase>(p));
+        outFile << getPhaseName(static_cast<Phase>(p)) << "," << total.calls << "," << total.seconds << "," << total.multiplies << "," << total.bytes << "\n";
+    }
+}
+
+Summary::~Summary() {
+    if (_destination == "" || _destination == "off") return;
+    if (_destination == "print") {
+        report(std::cout);
+        return;
+    }
+    try {
+        dump(_destination);
+    } catch (std::exception& e) {
+        std::cout << e.what() << std::endl;
+    }
+}
+
+}
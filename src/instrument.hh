@@ -0,0 +1,129 @@
+#ifndef INSTRUMENT_HH_
+#define INSTRUMENT_HH_
+
+//C++
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+
+namespace tracing {
+	/*Verbose and debug points as bits of a mask, so that a disabled point costs one test of a register rather than a
+	string comparison. Building with -DLQCD_NO_TRACE removes every trace and debug branch at compile time*/
+
+	enum Point : uint32_t {
+		load = 1u << 0,
+		movePoint = 1u << 1,
+		calcPlaquette = 1u << 2,
+		calcMeanPlaquette = 1u << 3,
+		getOverallPlaquetteMean = 1u << 4,
+		calcWilsonLoop = 1u << 5,
+		calcMeanWilsonLoopAtPoint = 1u << 6,
+		calcOverallMeanWilsonLoop = 1u << 7,
+		getWilsonLoopSample = 1u << 8,
+		calcWilsonLoopTable = 1u << 9,
+		fixTemporalGauge = 1u << 10,
+		calcPolyakovLoopCorrelator = 1u << 11,
+		calcPathStats = 1u << 12,
+		calcPlaquetteStats = 1u << 13,
+		smearLinks = 1u << 14
+	};
+
+	uint32_t parsePoints(std::string);
+
+	inline bool enabled(uint32_t mask, Point point) {
+#ifdef LQCD_NO_TRACE
+		(void)mask;
+		(void)point;
+		return false;
+#else
+		return (mask & point) != 0;
+#endif
+	}
+}
+
+namespace timing {
+	/*Wall-clock time and counted work of each phase of a run, accumulated over the whole process.
+	Phases are timed where they start and end, never inside parallel loops, and work is counted from the loop
+	bounds rather than per operation, so instrumentation adds two clock reads per phase call.
+	Phases run by the background loader overlap the measurement, so their times can add up to more than the run*/
+
+	enum class Phase {
+		read, //Mapping or reading config file and checking its size and checksums
+		load, //Decoding and validating links
+		loadWait, //Waiting for the background loader
+		generate, //Generating synthetic configs
+		gauge, //Gauge transformation
+		smear, //Link smearing
+		plaquette,
+		wilsonLoop, //Single (R,T) Wilson loops
+		wilsonTable, //Whole (R,T) Wilson loop table
+		polyakov,
+		paths, //Loops of general shape
+		halo, //MPI halo exchange
+		gather, //MPI gather of results
+		output, //Writing results
+		count
+	};
+
+	struct Work {
+		/*Matrix products, including trace-of-product kernels, and bytes of links or file read*/
+		double multiplies;
+		double bytes;
+	};
+
+	struct PhaseTotals {
+		size_t calls;
+		double seconds;
+		double multiplies;
+		double bytes;
+	};
+
+	std::string getPhaseName(Phase);
+	void record(Phase, double, Work);
+	PhaseTotals getTotals(Phase);
+	void report(std::ostream&);
+	void dump(std::string);
+
+	class Timer {
+		/*Adds the time from construction to destruction or stop, and the work counted in between, to a phase*/
+
+	private:
+		Phase _phase;
+		std::chrono::steady_clock::time_point _start;
+		Work _work;
+		bool _running;
+
+	public:
+		Timer(Phase phase) : _phase(phase), _start(std::chrono::steady_clock::now()), _work({0, 0}), _running(true) { }
+		~Timer() { stop(); }
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+		void count(Work work) { _work.multiplies += work.multiplies; _work.bytes += work.bytes; }
+		void stop() {
+			/*End the phase before the end of scope*/
+			if (!_running) return;
+			_running = false;
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+			record(_phase, elapsed.count(), _work);
+		}
+	};
+
+	class Summary {
+		/*Prints the phase summary when destroyed, for "print", or writes it as CSV to the named file. Empty or "off" does nothing*/
+
+	private:
+		std::string _destination;
+
+	public:
+		Summary(std::string destination) : _destination(destination) { }
+		~Summary();
+	};
+}
+
+#endif /* INSTRUMENT_HH_ */
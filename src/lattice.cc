@@ -8,15 +8,20 @@ std::pair<bool, double> doubleCompare(double value, double target,
 }
 
 Lattice::Lattice(std::array<size_t, 4> shape, std::string configName, 
-                 std::string verbose=0, std::string debug="") {
-    /*Initialise shape and read in configuration*/
+                 std::string verbose=0, std::string debug="", std::string validation="check", std::string format="double") {
+    /*Initialise shape and read in configuration. Validation is "check" to require unitary links, "fix" to reunitarise links
+    that are not, or "trust" to skip checks.
+    Format selects the in-memory link representation: double, tworow, float or tworowfloat*/
 
     _shape = shape;
-    _config = lattice(_shape);
-    _verbose = verbose;
-    _debug = debug;
-
-    Lattice::readConfig(configName);
+    _config.allocate(_shape, parseLinkFormat(format));
+    _verbose = tracing::parsePoints(verbose);
+    _debug = tracing::parsePoints(debug);
+    if (validation != "check" && validation != "trust" && validation != "fix") throw std::runtime_error("Unknown link validation: " + validation);
+    _validation = validation;
+    _temporalGauge = false;
+
+    if (configName != "") Lattice::readConfig(configName); //Empty name allocates storage to be filled by readConfig later
 }
 
 Lattice::~Lattice() { }
@@ -30,123 +35,223 @@ std::string Lattice::getDim(size_t m) {
     return "Invalid";
 }
 
-void Lattice::readConfig(std::string configName) {
-    /*Read inconfiguration from file*/
+std::string Lattice::getPoint(size_t site) {
+    /*Format coordinates of site for printing*/
+    std::array<size_t, 4> point = _config.coordinates(site);
+    return "(" + std::to_string(point[0]) + "," + std::to_string(point[1]) + "," + std::to_string(point[2]) + "," + std::to_string(point[3]) + ")";
+}
+
+void Lattice::fixTemporalGauge() {
+    /*Gauge transform the loaded configuration to temporal gauge. Gauge-invariant measurements are unaffected up to rounding*/
+    if (verbose(tracing::fixTemporalGauge)) std::cout << "Transforming configuration to temporal gauge\n";
+    timing::Timer timer(timing::Phase::gauge);
+    ::fixTemporalGauge(_config);
+    timer.count({7.*_config.getVolume(), 2.*_config.getBytes()}); //Two products per spatial link and one per temporal link
+    _temporalGauge = true;
+}
 
-    if (_verbose == "load") std::cout << "Reading configuration from: " << configName << "\n";
-    std::ifstream filein(configName.c_str(), std::ios::in | std::ios::binary);
+void Lattice::smearLinks(const SmearingParameters& parameters) {
+    /*Smear the spatial links of the loaded configuration in place. Smearing commutes with gauge transformations, so
+    it may come before or after fixTemporalGauge*/
+    if (parameters.method == "none") return;
+    if (verbose(tracing::smearLinks)) std::cout << "Smearing spatial links: " << parameters.describe() << ", spatial plaquette before " << PlaquetteEngine(_config).calcStats().spatial.mean << "\n";
+    SmearingEngine engine(_config, parameters);
+    timing::Timer timer(timing::Phase::smear);
+    engine.smear();
+    timer.count(engine.getWork(_shape[3]));
+    timer.stop();
+    if (verbose(tracing::smearLinks)) std::cout << "Spatial plaquette after smearing " << PlaquetteEngine(_config).calcStats().spatial.mean << "\n";
+}
 
-    double real, imaginary;
-    std::complex<double> det;
+bool Lattice::isTemporalGauge() {
+    return _temporalGauge;
+}
 
-    //Lattice iteration
-    for (size_t t = 0; t < _shape[3]; t++) { //Loop over t
-        for (size_t z = 0; z < _shape[2]; z++) { //Loop over z
-            for (size_t y = 0; y < _shape[1];y++) { //Loop over y
-                for (size_t x = 0; x < _shape[0]; x++) { //Loop over x
-
-                    direction tmp_direction;
-                    //Directional SU(3) iteration
-                    for (size_t d = 0; d < 4; d++) { //Loop through SU(3) matrices
-                        if (_verbose == "load") std::cout << "\nSU(3) matrix at lattice point (" << x << ", " << y << ", " << z << ", " << t << ") in " << Lattice::getDim(d) << " direction:\n";
-
-                        su3Matrix tmp_su3Matrix;
-                        //Elements of SU(3) matrix
-                        for (size_t a = 0; a < 3; a++) { //Loop through columns of SU(3) matrix
-                            for (size_t b = 0; b < 3; b++) { //Loop through rows of SU(3) matrix
-                                filein.read((char*)&real, 8);
-                                filein.read((char*)&imaginary, 8);
-                                if (_verbose == "load") std::cout << "(" << a << ", " << b << "): " << real << " + " << imaginary << "*i\n";
-                                tmp_su3Matrix(a, b) = std::complex<double>{real, imaginary};
-                            } 
-                        } //Elements
-
-                        det = xt::linalg::det(tmp_su3Matrix);
-                        if (_verbose == "load") std::cout << "Det = " << det << "\n";
-                        if (!doubleCompare(det.real(), 1.0).first | !doubleCompare(det.imag()+1, 1.0).first) {
-                            std::cout << "Matrix at (" << x << ", " << y << ", " << z << ", " << t << ") in " << Lattice::getDim(d) << " direction is not unitary\n";
-                            std::cout << "Relative distances are: " << doubleCompare(det.real(), 1.0).second << " and " << doubleCompare(det.imag()+1, 1.0).second << "\n";
-                            throw std::runtime_error("Non-unitary matrix");
-                        }
-
-                        tmp_direction(d) = tmp_su3Matrix;
-                        if (_debug == "load") throw std::runtime_error("Debug mode: Only print one SU(3) matrix");
-
-                    } //SU(3) matrices
-                    _config(x,y,z,t) = tmp_direction;
+su3Matrix toMatrix(const std::complex<double>* elements) {
+    /*Copy 9 row-major elements into an SU(3) matrix for printing*/
+    su3Matrix matrix;
+    std::copy(elements, elements + LinkField::linkSize, matrix.data());
+    return matrix;
+}
+
+su3Matrix Lattice::getLink(size_t site, size_t dir) {
+    /*Copy link in direction dir at site into an SU(3) matrix*/
+    std::complex<double> scratch[9];
+    return toMatrix(_config.fetch(site, dir, scratch));
+}
+
+void Lattice::printLinks() {
+    /*Print every link and its determinant in file order*/
+    for (size_t site = 0; site < _config.getVolume(); site++) {
+        for (size_t d = 0; d < 4; d++) { //Loop through SU(3) matrices
+            std::cout << "\nSU(3) matrix at lattice point " << getPoint(site) << " in " << Lattice::getDim(d) << " direction:\n";
+            std::complex<double> scratch[9];
+            const std::complex<double>* link = _config.fetch(site, d, scratch);
+            for (size_t a = 0; a < 3; a++) { //Loop through rows of SU(3) matrix
+                for (size_t b = 0; b < 3; b++) { //Loop through columns of SU(3) matrix
+                    std::cout << "(" << a << ", " << b << "): " << link[3*a+b].real() << " + " << link[3*a+b].imag() << "*i\n";
                 }
             }
+            std::cout << "Det = " << su3::det(link) << "\n";
+            if (debug(tracing::load)) throw std::runtime_error("Debug mode: Only print one SU(3) matrix");
         }
-    } //Lattice points
+    }
+}
+
+void Lattice::readConfig(std::string configName) {
+    /*Read in configuration from memory-mapped file, decoding and validating links in parallel.
+    File holds the links as (real, imaginary) doubles with t outermost, which matches the linear site index.
+    Files in the native format are read by readNativeConfig instead*/
+
+    if (verbose(tracing::load)) std::cout << "Reading configuration from: " << configName << "\n";
+    if (ConfigFile::isNativeFile(configName)) {
+        readNativeConfig(configName);
+        return;
+    }
+    timing::Timer readTimer(timing::Phase::read);
+    MappedFile file(configName);
+    const size_t siteElements = 4*LinkField::linkSize;
+    const size_t expected = _config.getVolume()*siteElements*sizeof(std::complex<double>);
+    if (file.size() != expected) {
+        std::cout << "Configuration " << configName << " holds " << file.size() << " bytes but lattice shape requires " << expected << std::endl;
+        throw std::runtime_error("Configuration size does not match lattice shape");
+    }
+
+    readTimer.stop();
 
-    filein.close();
+    const std::complex<double>* source = reinterpret_cast<const std::complex<double>*>(file.data());
+    const bool validate = _validation != "trust";
+    _temporalGauge = false;
+    const size_t nLinks = 4*_config.getVolume();
+    timing::Timer loadTimer(timing::Phase::load);
+    _fixes = FixStats();
+    size_t firstInvalid = _config.load(source, 0, _shape[3], validate, (_validation == "fix") ? &_fixes : nullptr);
+    loadTimer.count({0, static_cast<double>(file.size() + _config.getBytes())});
+    loadTimer.stop();
+
+    if (verbose(tracing::load) || debug(tracing::load)) printLinks();
+
+    if (_fixes.count > 0) {
+        std::cout << "Reunitarised " << _fixes.count << " of " << nLinks << " links in " << configName << ": largest deviation from SU(3) "
+                  << _fixes.maxDeviation << ", largest element change " << _fixes.maxChange << ", mean " << _fixes.meanChange() << "\n";
+    }
+    if (firstInvalid < nLinks) {
+        size_t site = firstInvalid/4, d = firstInvalid%4;
+        const std::complex<double>* link = source + firstInvalid*LinkField::linkSize;
+        std::complex<double> det = su3::det(link);
+        std::cout << "Matrix at " << getPoint(site) << " in " << Lattice::getDim(d) << " direction is not unitary\n";
+        std::cout << "Relative distances are: " << doubleCompare(det.real(), 1.0).second << " and " << doubleCompare(det.imag()+1, 1.0).second << "\n";
+        std::cout << "Largest element of U.U^dagger - 1 is: " << su3::unitarityDeviation(link) << std::endl;
+        throw std::runtime_error("Non-unitary matrix");
+    }
 }
 
-void Lattice::test(){
-    /*Test function for random things*/
-    std::array<size_t, 4> test = {0,2,4,5};
-    //_config[test[0]][test[1]][test[2]][test[3]];
-    std::cout << _config[test] << "\n";
+void Lattice::readNativeConfig(std::string configName) {
+    /*Read in configuration from a native file, with timeslices read, checked against their CRC, decoded and validated
+    in parallel. Links stored in single precision are validated with a looser tolerance*/
+    timing::Timer readTimer(timing::Phase::read);
+    ConfigFile file(configName, _shape);
+    readTimer.stop();
+
+    const size_t nLinks = 4*_config.getVolume();
+    _temporalGauge = false;
+    timing::Timer loadTimer(timing::Phase::load);
+    _fixes = FixStats();
+    size_t firstInvalid = file.load(_config, 0, _shape[3], 0, _validation != "trust", (_validation == "fix") ? &_fixes : nullptr);
+    loadTimer.count({0, static_cast<double>(file.getBytes() + _config.getBytes())});
+    loadTimer.stop();
+
+    if (verbose(tracing::load) || debug(tracing::load)) printLinks();
+
+    if (_fixes.count > 0) {
+        std::cout << "Reunitarised " << _fixes.count << " of " << nLinks << " links in " << configName << ": largest deviation from SU(3) "
+                  << _fixes.maxDeviation << ", largest element change " << _fixes.maxChange << ", mean " << _fixes.meanChange() << "\n";
+    }
+    if (firstInvalid < nLinks) {
+        size_t site = firstInvalid/4, d = firstInvalid%4;
+        std::complex<double> scratch[9];
+        const std::complex<double>* link = _config.fetch(site, d, scratch);
+        std::cout << "Matrix at " << getPoint(site) << " in " << Lattice::getDim(d) << " direction is not unitary\n";
+        std::cout << "Determinant is: " << su3::det(link) << "\n";
+        std::cout << "Largest element of U.U^dagger - 1 is: " << su3::unitarityDeviation(link) << std::endl;
+        throw std::runtime_error("Non-unitary matrix");
+    }
 }
 
-size_t modulo(int a, int b) {
-    /*Modulo that also works with negaive numbers*/
-    return (a%b+b)%b;
+void Lattice::generateConfig(const ConfigGenerator& generator) {
+    /*Fill configuration with synthetic links instead of reading it from file*/
+    if (verbose(tracing::load)) std::cout << "Generating configuration\n";
+    _temporalGauge = false;
+    timing::Timer timer(timing::Phase::generate);
+    generator.fill(_config);
+    timer.count({0, static_cast<double>(_config.getBytes())});
+    timer.stop();
+    if (verbose(tracing::load) || debug(tracing::load)) printLinks();
 }
 
-std::array<size_t, 4> Lattice::movePoint(std::array<size_t, 4> point, size_t direction, int amount) {
-    /*Move position in grid whilst respecting peiodic boundaries*/
-    if (_verbose == "movePoint") {
-        std::cout << "\nCurrect point: " << point[direction] << " and moving " << amount << " steps\n";
-        std::cout << "Candidate point is: " << static_cast<int>(point[direction])+amount << "\n";
-        std::cout << "Periodic boundary conditions means new point is: " << modulo(static_cast<int>(point[direction])+amount, _shape[direction]) << "\n";
-    }
-    point[direction] = modulo(static_cast<int>(point[direction])+amount, _shape[direction]);
-    return point;
+void Lattice::test(){
+    /*Test function for random things*/
+    size_t test = _config.index({0,2,4,5});
+    for (size_t d = 0; d < 4; d++) std::cout << getLink(test, d) << "\n";
 }
 
-std::complex<double> Lattice::calcPlaquette(std::array<size_t, 4> point, std::pair<size_t, size_t> plane) {
+size_t Lattice::movePoint(size_t site, size_t direction, int amount) {
+    /*Move position in grid whilst respecting peiodic boundaries, using tabulated neighbours*/
+    if (verbose(tracing::movePoint)) std::cout << "\nCurrect point: " << getPoint(site) << " and moving " << amount << " steps in " << getDim(direction) << " direction\n";
+    for (int i = 0; i < amount; i++) site = _config.next(site, direction);
+    for (int i = 0; i > amount; i--) site = _config.prev(site, direction);
+    if (verbose(tracing::movePoint)) std::cout << "Periodic boundary conditions means new point is: " << getPoint(site) << "\n";
+    return site;
+}
+
+std::complex<double> Lattice::calcPlaquette(size_t point, std::pair<size_t, size_t> plane) {
     /*Calculate value of plaquette at specified starting gridpoint and 2D plane*/
-    if (_verbose == "calcPlaquette") std::cout << "\nCalculating plaquette at (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") in plane (" << getDim(plane.first) << ":" << getDim(plane.second) << ")\n";
+    if (verbose(tracing::calcPlaquette)) std::cout << "\nCalculating plaquette at " << getPoint(point) << " in plane (" << getDim(plane.first) << ":" << getDim(plane.second) << ")\n";
+
+    std::complex<double> scratch[4][9];
 
     //Link in mu direction at point
-    su3Matrix u = _config[point][plane.first]; 
-    if (_verbose == "calcPlaquette") std::cout << "U matrix:\n" << u << "\n At point: (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ")\n";
+    const std::complex<double>* u = _config.fetch(point, plane.first, scratch[0]);
+    if (verbose(tracing::calcPlaquette)) std::cout << "U matrix:\n" << toMatrix(u) << "\n At point: " << getPoint(point) << "\n";
     
     //Link in nu direction at point+mu
-    std::array<size_t, 4> tmp_point = movePoint(point, plane.first, 1);
-    su3Matrix v = _config[tmp_point][plane.second]; 
-    if (_verbose == "calcPlaquette") {
-        std::cout << "V matrix:\n" << v << "\n At point: (" << tmp_point[0] << "," << tmp_point[1] << "," << tmp_point[2] << "," << tmp_point[3] << ")\n";;
+    size_t tmp_point = _config.next(point, plane.first);
+    const std::complex<double>* v = _config.fetch(tmp_point, plane.second, scratch[1]);
+    if (verbose(tracing::calcPlaquette)) {
+        std::cout << "V matrix:\n" << toMatrix(v) << "\n At point: " << getPoint(tmp_point) << "\n";
     }
     
     //Reverse of link in mu direction at point+nu
-    tmp_point = movePoint(point, plane.second, 1);
-    su3Matrix uprime = xt::conj(xt::transpose(_config[tmp_point][plane.first]));
-
-    if (_verbose == "calcPlaquette") {
-        std::cout << "U prime matrix:\n" << _config[tmp_point][plane.first] << "\nconjugate transpose:\n" << uprime << "\n At point: (" << tmp_point[0] << "," << tmp_point[1] << "," << tmp_point[2] << "," << tmp_point[3] << ")\n";
+    tmp_point = _config.next(point, plane.second);
+    const std::complex<double>* uprime = _config.fetch(tmp_point, plane.first, scratch[2]);
+    if (verbose(tracing::calcPlaquette)) {
+        std::cout << "U prime matrix:\n" << toMatrix(uprime) << "\nconjugate transpose:\n" << xt::conj(xt::transpose(toMatrix(uprime))) << "\n At point: " << getPoint(tmp_point) << "\n";
     }
     
     //Reverse of link in nu direction at point
-    su3Matrix vprime = xt::conj(xt::transpose(_config[point][plane.second]));
-    if (_verbose == "calcPlaquette") std::cout << "V prime matrix:\n" << _config[point][plane.second] << "\nconjugate transpose:\n" << vprime << "\n At point: (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ")\n";
+    const std::complex<double>* vprime = _config.fetch(point, plane.second, scratch[3]);
+    if (verbose(tracing::calcPlaquette)) std::cout << "V prime matrix:\n" << toMatrix(vprime) << "\nconjugate transpose:\n" << xt::conj(xt::transpose(toMatrix(vprime))) << "\n At point: " << getPoint(point) << "\n";
     
-    //Compute plaquette
-
-    su3Matrix product = xt::linalg::dot(u, xt::linalg::dot(v, xt::linalg::dot(uprime, vprime)));
-    if (_verbose == "calcPlaquette") std::cout << "Plaquette product:\n" << product << "\n";
-    std::complex<double> trace = xt::sum(xt::diagonal(product))[0];
-    if (_verbose == "calcPlaquette") std::cout << "Plaquette trace: " << trace << "\n\n";
+    //Compute plaquette as tr[(U.V).(V'.U')^dagger] without forming the full product
+    std::complex<double> upper[9], lower[9];
+    su3::mul(u, v, upper);
+    su3::mul(vprime, uprime, lower);
+    if (verbose(tracing::calcPlaquette)) {
+        std::complex<double> product[9];
+        su3::mulDagRight(upper, lower, product);
+        std::cout << "Plaquette product:\n" << toMatrix(product) << "\n";
+    }
+    std::complex<double> trace = su3::traceMulDag(upper, lower);
+    if (verbose(tracing::calcPlaquette)) std::cout << "Plaquette trace: " << trace << "\n\n";
 
-    if (_debug == "calcPlaquette") throw std::runtime_error("Debug mode: Only try one product");
+    if (debug(tracing::calcPlaquette)) throw std::runtime_error("Debug mode: Only try one product");
 
     return trace/3.;
 }
 
-std::complex<double> Lattice::calcMeanPlaquette(std::array<size_t, 4> point) {
+std::complex<double> Lattice::calcMeanPlaquette(size_t point) {
     /*Compute mean value of possible plaquttes at given point*/
-    if (_verbose == "calcMeanPlaquette") std::cout << "\nCalculating plaquettes at (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ")\n";
+    if (verbose(tracing::calcMeanPlaquette)) std::cout << "\nCalculating plaquettes at " << getPoint(point) << "\n";
     xt::xtensor_fixed<std::complex<double>, xt::xshape<6>> plaquttes;
 
     //Compute all possible plaquttes at point
@@ -154,169 +259,288 @@ std::complex<double> Lattice::calcMeanPlaquette(std::array<size_t, 4> point) {
     for (size_t i = 0; i <= 2; i++) {
         for (size_t j = i+1; j <= 3; j++) {
             plaquttes[p] = calcPlaquette(point, {i,j});
-            if (_verbose == "calcMeanPlaquette") std::cout << "Plaquette (" << getDim(i) << ":" << getDim(j) << ") is: " << plaquttes[p] << "\n";
+            if (verbose(tracing::calcMeanPlaquette)) std::cout << "Plaquette (" << getDim(i) << ":" << getDim(j) << ") is: " << plaquttes[p] << "\n";
             p++;
         }
     }
 
     //Compute means of plaquettes
-    if (_verbose == "calcMeanPlaquette") {
+    if (verbose(tracing::calcMeanPlaquette)) {
         std::cout << "Mean spatial:spatial: " << xt::mean(xt::index_view(plaquttes, {{0},{1},{3}})) << "\n";
         std::cout << "Mean spatial:temporal: " << xt::mean(xt::index_view(plaquttes, {{2},{4},{5}})) << "\n";
     }
     std::complex<double> mean = xt::mean(plaquttes)[0];
-    if (_verbose == "calcMeanPlaquette") std::cout << "Mean: " << mean << "\n";
+    if (verbose(tracing::calcMeanPlaquette)) std::cout << "Mean: " << mean << "\n";
     return mean;
 }
 
 double Lattice::getOverallPlaquetteMean() {
-    /*Calculate means of plaquettes at all lattice points and return real part*/
+    /*Calculate mean of the real part of plaquettes over all lattice points. Per-site tracing walks the sites one at a
+    time through calcMeanPlaquette, otherwise the parallel plaquette engine is used*/
+    if (!verbose(tracing::calcPlaquette) && !verbose(tracing::calcMeanPlaquette) && !verbose(tracing::getOverallPlaquetteMean) && !debug(tracing::calcPlaquette)) {
+        return calcPlaquetteStats().overall().mean;
+    }
+
     double sum = 0;
     double tmp_mean;
     size_t p = 0;
+    timing::Timer timer(timing::Phase::plaquette);
+    timer.count({18.*_config.getVolume(), 24.*_config.getVolume()*_config.getLinkBytes()}); //Three products and four links per plaquette
     
     //Lattice iteration
-    for (size_t t = 0; t < _shape[3]; t++) { //Loop over t
-        for (size_t z = 0; z < _shape[2]; z++) { //Loop over z
-            for (size_t y = 0; y < _shape[1]; y++) { //Loop over y
-                for (size_t x = 0; x < _shape[0]; x++) { //Loop over x
-                    tmp_mean = calcMeanPlaquette({x,y,z,t}).real();
-                    sum +=  tmp_mean;
-                    if (_verbose == "getOverallPlaquetteMean") std::cout << "Mean at (" << x << "," << y << "," << z << "," << t << "): " << tmp_mean << "\n";
-                    p++;
-                }
-            }
-        }
+    for (size_t site = 0; site < _config.getVolume(); site++) {
+        tmp_mean = calcMeanPlaquette(site).real();
+        sum +=  tmp_mean;
+        if (verbose(tracing::getOverallPlaquetteMean)) std::cout << "Mean at " << getPoint(site) << ": " << tmp_mean << "\n";
+        p++;
     }
 
     double mean = sum/p;
-    if (_verbose == "getOverallPlaquetteMean") std::cout << "Overall mean: " << mean << "\n";
+    if (verbose(tracing::getOverallPlaquetteMean)) std::cout << "Overall mean: " << mean << "\n";
     return mean;
 }
 
-std::complex<double> Lattice::calcWilsonLoop(std::array<size_t, 4> point, size_t spatialDimension, size_t R, size_t T) {
+PlaquetteStats Lattice::calcPlaquetteStats() {
+    /*Calculate mean, variance and count of Re tr(P)/3 over all plaquettes in one parallel pass, with the spatial/spatial
+    and spatial/temporal planes kept separate*/
+    timing::Timer timer(timing::Phase::plaquette);
+    PlaquetteEngine engine(_config);
+    PlaquetteStats stats = engine.calcStats();
+    timer.count(engine.getWork());
+    timer.stop();
+    if (verbose(tracing::calcPlaquetteStats)) {
+        std::cout << "Mean spatial:spatial plaquette: " << stats.spatial.mean << "+-" << stats.spatial.std() << "\n";
+        std::cout << "Mean spatial:temporal plaquette: " << stats.temporal.mean << "+-" << stats.temporal.std() << "\n";
+        std::cout << "Mean plaquette: " << stats.overall().mean << "\n";
+    }
+    return stats;
+}
+
+std::complex<double> Lattice::calcWilsonLoop(size_t point, size_t spatialDimension, size_t R, size_t T) {
     /*Compute latice loop starting at given point with spatial width r and temporal width t in given spatial direction*/
-    if (_verbose == "calcWilsonLoop") std::cout << "\nCalculating Wilson loop at (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") in " << getDim(spatialDimension) << " direction for (R,T) = (" << R << "," << T << ")\n";
+    if (verbose(tracing::calcWilsonLoop)) std::cout << "\nCalculating Wilson loop at " << getPoint(point) << " in " << getDim(spatialDimension) << " direction for (R,T) = (" << R << "," << T << ")\n";
     
-    su3Matrix product({{1,0,0},{0,1,0},{0,0,1}});
-    su3Matrix tmp;
+    std::complex<double> product[9], scratch[9];
+    su3::setIdentity(product);
 
     //Reverse link in temporal direction
     for (size_t i = 0; i < T; i++) {
-        tmp = xt::conj(xt::transpose(_config[point][3]));
-        product = xt::linalg::dot(tmp, product);
-        if (_verbose == "calcWilsonLoop") std::cout << "Reverse temporal link " << i << " at point: (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") is\n" << _config[point][3] << "\nconjugate transpose\n" << tmp << "\n";
-        point = movePoint(point, 3, 1);
+        su3::mulDagLeft(_config.fetch(point, 3, scratch), product, product);
+        if (verbose(tracing::calcWilsonLoop)) std::cout << "Reverse temporal link " << i << " at point: " << getPoint(point) << " is\n" << getLink(point, 3) << "\nconjugate transpose\n" << xt::conj(xt::transpose(getLink(point, 3))) << "\n";
+        point = _config.next(point, 3);
     }
 
     //Reverse link in spatial direction
     for (size_t i = 0; i < R; i++) {
-        tmp = xt::conj(xt::transpose(_config[point][spatialDimension]));
-        product = xt::linalg::dot(tmp, product);
-        if (_verbose == "calcWilsonLoop") std::cout << "Reverse spatial link " << i << " at point: (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") is\n" << _config[point][spatialDimension] << "\nconjugate transpose\n" << tmp << "\n";
-        point = movePoint(point, spatialDimension, 1);  
+        su3::mulDagLeft(_config.fetch(point, spatialDimension, scratch), product, product);
+        if (verbose(tracing::calcWilsonLoop)) std::cout << "Reverse spatial link " << i << " at point: " << getPoint(point) << " is\n" << getLink(point, spatialDimension) << "\nconjugate transpose\n" << xt::conj(xt::transpose(getLink(point, spatialDimension))) << "\n";
+        point = _config.next(point, spatialDimension);
     }
 
     //Link in temporal direction
     for (size_t i = 0; i < T; i++) {
-        point = movePoint(point, 3, -1);
-        product = xt::linalg::dot(_config[point][3], product);
-        if (_verbose == "calcWilsonLoop") std::cout << "Temporal link " << i << " at point: (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") is\n" << _config[point][3] << "\n";
+        point = _config.prev(point, 3);
+        su3::mul(_config.fetch(point, 3, scratch), product, product);
+        if (verbose(tracing::calcWilsonLoop)) std::cout << "Temporal link " << i << " at point: " << getPoint(point) << " is\n" << getLink(point, 3) << "\n";
     }
 
     //Link in spatial direction
     for (size_t i = 0; i < R; i++) {
-        point = movePoint(point, spatialDimension, -1);
-        product = xt::linalg::dot(_config[point][spatialDimension], product);
-        if (_verbose == "calcWilsonLoop") std::cout << "Spatial link " << i << " at point: (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") is\n" << _config[point][spatialDimension] << "\n";
+        point = _config.prev(point, spatialDimension);
+        su3::mul(_config.fetch(point, spatialDimension, scratch), product, product);
+        if (verbose(tracing::calcWilsonLoop)) std::cout << "Spatial link " << i << " at point: " << getPoint(point) << " is\n" << getLink(point, spatialDimension) << "\n";
     }
 
     //Compute trace
-    if (_verbose == "calcWilsonLoop") std::cout << "Wilson loop product:\n" << product << "\n";
-    std::complex<double> trace = xt::sum(xt::diagonal(product))[0];
-    if (_verbose == "calcWilsonLoop") std::cout << "Wilson loop trace: " << trace << "\n\n";
+    if (verbose(tracing::calcWilsonLoop)) std::cout << "Wilson loop product:\n" << toMatrix(product) << "\n";
+    std::complex<double> trace = su3::trace(product);
+    if (verbose(tracing::calcWilsonLoop)) std::cout << "Wilson loop trace: " << trace << "\n\n";
 
-    if (_debug == "calcWilsonLoop") throw std::runtime_error("Debug mode: Only try one product");
+    if (debug(tracing::calcWilsonLoop)) throw std::runtime_error("Debug mode: Only try one product");
 
     return trace/3.;
 }
 
-std::complex<double> Lattice::calcMeanWilsonLoopAtPoint(std::array<size_t, 4> point, size_t R, size_t T) {
+std::complex<double> Lattice::calcMeanWilsonLoopAtPoint(size_t point, size_t R, size_t T) {
     /*Calulcate mean Wilson loop with spatial width r and temporal width t across all spatial dimensions at given point*/
-    if (_verbose == "calcMeanWilsonLoopAtPoint") std::cout << "\nCalculating mean Wilson loop at (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") for (R,T) = (" << R << "," << T << ")\n";
+    if (verbose(tracing::calcMeanWilsonLoopAtPoint)) std::cout << "\nCalculating mean Wilson loop at " << getPoint(point) << " for (R,T) = (" << R << "," << T << ")\n";
     
     xt::xtensor_fixed<std::complex<double>, xt::xshape<3>> loops;
 
     for (size_t i = 0; i < 3; i++) {
         loops[i] = calcWilsonLoop(point, i, R, T);
-        if (_verbose == "calcMeanWilsonLoopAtPoint") std::cout << "\n Wilson loop at (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") in " << getDim(i) << " direction for (R,T) = (" << R << "," << T << ") is " << loops[i] << "\n";
+        if (verbose(tracing::calcMeanWilsonLoopAtPoint)) std::cout << "\n Wilson loop at " << getPoint(point) << " in " << getDim(i) << " direction for (R,T) = (" << R << "," << T << ") is " << loops[i] << "\n";
     }
 
     std::complex<double> mean = xt::mean(loops)[0];
-    if (_verbose == "calcMeanWilsonLoopAtPoint") std::cout << "Mean: " << mean << "\n";
-    if (_debug == "calcMeanWilsonLoopAtPoint") throw std::runtime_error("Debug mode: Only try one point");
+    if (verbose(tracing::calcMeanWilsonLoopAtPoint)) std::cout << "Mean: " << mean << "\n";
+    if (debug(tracing::calcMeanWilsonLoopAtPoint)) throw std::runtime_error("Debug mode: Only try one point");
 
     return mean;
 }
 
 std::pair<double, double> Lattice::calcOverallMeanWilsonLoop(size_t R, size_t T) {
-    /*Get mean of all Wilson loops*/
-    if (_verbose == "calcOverallMeanWilsonLoop") std::cout << "\nCalculating all Wilson loops of (R,T) = (" << R << "," << T << ")\n";
-    xt::xtensor<double, 1> traces = getWilsonLoopSample(R, T);
-    double mean = xt::mean(traces)[0];
-    double std = sqrt(xt::sum(xt::pow(traces-mean, 2))[0]/static_cast<double>(traces.size()));
-
-    if (_verbose == "calcOverallMeanWilsonLoop") std::cout << "Mean: " << xt::mean(traces) << "+-" << std << "\n";
-    return std::make_pair(mean, std);
+    /*Get mean and standard deviation of all Wilson loops*/
+    if (verbose(tracing::calcOverallMeanWilsonLoop)) std::cout << "\nCalculating all Wilson loops of (R,T) = (" << R << "," << T << ")\n";
+    RunningStats stats = calcWilsonLoopStats(R, T);
+
+    if (verbose(tracing::calcOverallMeanWilsonLoop)) std::cout << "Mean: " << stats.mean << "+-" << stats.std() << "\n";
+    return std::make_pair(stats.mean, stats.std());
+}
+
+std::vector<PolyakovBin> Lattice::calcPolyakovLoopCorrelator() {
+    /*Correlator of Polyakov loops <P(x).P(x+r)^*> over all spatial separations r, averaged over separations of equal |r|*/
+    timing::Timer timer(timing::Phase::polyakov);
+    timer.count({(_shape[3]-1.)*_config.getSpatialVolume(), static_cast<double>(_config.getVolume()*_config.getLinkBytes())}); //Temporal links only
+    PolyakovEngine engine(_config);
+    std::vector<std::complex<double>> loops = engine.calcLoops();
+    if (verbose(tracing::calcPolyakovLoopCorrelator)) {
+        std::complex<double> sum = 0;
+        for (const std::complex<double>& loop : loops) sum += loop;
+        std::cout << "\nMean Polyakov loop: " << sum/static_cast<double>(loops.size()) << "\n";
+    }
+
+    std::vector<PolyakovBin> bins = engine.binCorrelator(engine.calcCorrelator(loops));
+    if (verbose(tracing::calcPolyakovLoopCorrelator)) {
+        for (const PolyakovBin& bin : bins) std::cout << "|r|^2 = " << bin.r2 << " (" << bin.count << " separations): " << bin.correlator << "\n";
+    }
+    return bins;
+}
+
+std::vector<RunningStats> Lattice::calcPathStats(const std::vector<Path>& paths) {
+    /*Mean, variance and count of Re tr[U_path(x)]/3 over all sites for each closed path, with shared prefixes of the paths multiplied once per site*/
+    timing::Timer timer(timing::Phase::paths);
+    PathEngine engine(_config, paths);
+    if (verbose(tracing::calcPathStats)) std::cout << "\nCalculating " << paths.size() << " paths with " << engine.getNodes() << " distinct prefixes\n";
+    std::vector<RunningStats> stats = engine.calcStats();
+    timer.count(engine.getWork());
+    timer.stop();
+
+    if (verbose(tracing::calcPathStats)) {
+        for (size_t p = 0; p < paths.size(); p++) std::cout << formatPath(paths[p]) << ": " << stats[p].mean << "+-" << stats[p].std() << "\n";
+    }
+    return stats;
 }
 
 std::array<size_t, 4> Lattice::getShape() {
     return _shape;
 }
 
+const LinkField& Lattice::getLinks() {
+    return _config;
+}
+
 xt::xtensor<double, 1> Lattice::getWilsonLoopSample(size_t R, size_t T) {
     /*Calculate all Wilson loops of spatial width r and temporal width t across entire lattice*/
-    if (_verbose == "getWilsonLoopSample") std::cout << "\nCalculating all Wilson loops of (R,T) = (" << R << "," << T << ")\n";
+    if (verbose(tracing::getWilsonLoopSample)) std::cout << "\nCalculating all Wilson loops of (R,T) = (" << R << "," << T << ")\n";
 
     xt::xtensor<double, 1> traces = xt::xtensor<double, 1>(std::array<size_t, 1>{_shape[0]*_shape[1]*_shape[2]*_shape[3]*3});
+    timing::Timer timer(timing::Phase::wilsonLoop);
+    timer.count({6.*_config.getVolume()*(R+T), 6.*_config.getVolume()*(R+T)*_config.getLinkBytes()}); //2(R+T) links and products per loop
 
     //Lattice iteration
     int p = 0;
-    for (size_t t = 0; t < _shape[3]; t++) { //Loop over t
-        for (size_t z = 0; z < _shape[2]; z++) { //Loop over z
-            for (size_t y = 0; y < _shape[1]; y++) { //Loop over y
-                for (size_t x = 0; x < _shape[0]; x++) { //Loop over x
-                    //Direction iteration
-                    for (size_t i = 0; i < 3; i++) {
-                        traces[p] = calcWilsonLoop({x,y,z,t}, i, R, T).real();
-                        if (_verbose == "getWilsonLoopSample") std::cout << "Loop at (" << x << "," << y << "," << z << "," << t << ") in direction " << getDim(i) << ": " << traces[p] << "\n";
-                        p++;
-                    }
-                }
-            }
+    for (size_t site = 0; site < _config.getVolume(); site++) {
+        //Direction iteration
+        for (size_t i = 0; i < 3; i++) {
+            traces[p] = calcWilsonLoop(site, i, R, T).real();
+            if (verbose(tracing::getWilsonLoopSample)) std::cout << "Loop at " << getPoint(site) << " in direction " << getDim(i) << ": " << traces[p] << "\n";
+            p++;
         }
     }
 
-    if (_verbose == "getWilsonLoopSample") std::cout << "Overall mean: " << xt::mean(traces) << "\n";
+    if (verbose(tracing::getWilsonLoopSample)) std::cout << "Overall mean: " << xt::mean(traces) << "\n";
     return traces;
 }
 
 double Lattice::calcOverallMeanWilsonLoopMP(size_t R, size_t T) {
     /*Calculate mean of all Wilson loops of spatial width r and temporal width t across entire lattice with multi processing*/
-    double sum = 0;
+    return calcWilsonLoopStats(R, T).mean;
+}
 
-    #pragma omp parallel for reduction(+:sum)
-    for (size_t t = 0; t < _shape[3]; t++) { //Loop over t
-        for (size_t z = 0; z < _shape[2]; z++) { //Loop over z
-            for (size_t y = 0; y < _shape[1]; y++) { //Loop over y
-                for (size_t x = 0; x < _shape[0]; x++) { //Loop over x
-                    for (size_t i = 0; i < 3; i++) { //Direction iteration
-                        sum += calcWilsonLoop({x,y,z,t}, i, R, T).real();
-                    }
-                }
-            }
+RunningStats Lattice::calcWilsonLoopStats(size_t R, size_t T) {
+    /*Mean, variance and count of all Wilson loops of spatial width r and temporal width t in a single parallel pass,
+    without storing the sample*/
+    return calcWilsonLoopStats(std::vector<std::pair<size_t, size_t>>{{R, T}})[0];
+}
+
+std::vector<RunningStats> Lattice::calcWilsonLoopStats(const std::vector<std::pair<size_t, size_t>>& sizes) {
+    /*Mean, variance and count of all Wilson loops of each (R,T) in sizes, computed loop by loop with one parallel pass for all sizes.
+    Work items are one size, direction and z plane of one timeslice, weighted by R+T, and are shared between threads by
+    work stealing. Statistics are kept per item and merged in a fixed order, so they do not depend on the thread count*/
+    const size_t planeSites = _shape[0]*_shape[1];
+    const size_t nPlanes = _shape[2]*_shape[3];
+    const size_t nItems = sizes.size()*nPlanes*3;
+    timing::Timer timer(timing::Phase::wilsonLoop);
+    std::vector<double> costs(nItems);
+    for (size_t item = 0; item < nItems; item++) {
+        const std::pair<size_t, size_t>& size = sizes[item/(3*nPlanes)];
+        costs[item] = size.first + size.second;
+        timer.count({2.*planeSites*costs[item], 2.*planeSites*costs[item]*_config.getLinkBytes()}); //2(R+T) links and products per loop
+    }
+
+    std::vector<RunningStats> itemStats(nItems);
+    auto setup = []() { return 0; };
+    auto work = [&](int, size_t item) {
+        const std::pair<size_t, size_t>& size = sizes[item/(3*nPlanes)];
+        const size_t plane = (item/3)%nPlanes, i = item%3;
+        for (size_t site = plane*planeSites; site < (plane+1)*planeSites; site++) { //Loop over sites in plane
+            itemStats[item].add(calcWilsonLoop(site, i, size.first, size.second).real());
+        }
+    };
+    scheduleWork(costs, setup, work);
+
+    std::vector<RunningStats> stats(sizes.size());
+    for (size_t item = 0; item < nItems; item++) stats[item/(3*nPlanes)].merge(itemStats[item]);
+    return stats;
+}
+
+xt::xtensor<RunningStats, 2> Lattice::calcWilsonLoopTable(size_t maxR, size_t maxT, Checkpoint* checkpoint) {
+    /*Calculate mean, variance and count of Wilson loops for all R <= maxR and T <= maxT in a single pass over the lattice, indexed as (R,T).
+    Once the configuration is in temporal gauge the loops are correlations of spatial lines between timeslices.
+    With a checkpoint, the pass is split into blocks of timeslices which are recorded as they finish, and blocks recorded
+    by an earlier run are not measured again. The result is the same as without the checkpoint*/
+    if (verbose(tracing::calcWilsonLoopTable)) std::cout << "\nCalculating all Wilson loops up to (R,T) = (" << maxR << "," << maxT << ")" << (_temporalGauge ? " in temporal gauge" : "") << "\n";
+    timing::Timer timer(timing::Phase::wilsonTable);
+    std::vector<RunningStats> stats;
+    if (_temporalGauge) {
+        TemporalGaugeEngine engine(_config, maxR, maxT);
+        stats = engine.calcStats();
+        timer.count(engine.getWork());
+    } else if (checkpoint == nullptr) {
+        WilsonEngine engine(_config, maxR, maxT);
+        stats = engine.calcStats();
+        timer.count(engine.getWork(_shape[3]));
+    } else {
+        WilsonEngine engine(_config, maxR, maxT);
+        const size_t nEntries = engine.getEntries();
+        std::vector<RunningStats> sliceStats(_shape[3]*nEntries);
+        std::vector<bool> done(_shape[3], false);
+        for (const SliceBlock& block : checkpoint->getBlocks()) {
+            if (block.stats.size()%nEntries != 0 || block.first + block.stats.size()/nEntries > _shape[3]) throw std::runtime_error("Checkpoint " + checkpoint->getName() + " does not match the Wilson loop table");
+            std::copy(block.stats.begin(), block.stats.end(), sliceStats.begin() + block.first*nEntries);
+            std::fill(done.begin() + block.first, done.begin() + block.first + block.stats.size()/nEntries, true);
         }
+
+        const size_t blockSlices = (_shape[3] + Checkpoint::blocksPerConfig - 1)/Checkpoint::blocksPerConfig;
+        for (size_t first = 0; first < _shape[3]; first += blockSlices) { //Loop over blocks of t
+            size_t nSlices = std::min(blockSlices, _shape[3] - first);
+            if (std::all_of(done.begin() + first, done.begin() + first + nSlices, [](bool slice) { return slice; })) continue;
+            std::vector<RunningStats> block = engine.calcSliceStats(first, nSlices);
+            checkpoint->addBlock(first, block);
+            std::copy(block.begin(), block.end(), sliceStats.begin() + first*nEntries);
+            timer.count(engine.getWork(nSlices));
+        }
+        stats = engine.combineSliceStats(sliceStats);
     }
+    timer.stop();
 
-    return sum/(_shape[0]*_shape[1]*_shape[2]*_shape[3]*3);
+    xt::xtensor<RunningStats, 2> table = xt::xtensor<RunningStats, 2>(std::array<size_t, 2>{maxR+1, maxT+1});
+    for (size_t R = 0; R <= maxR; R++) {
+        for (size_t T = 0; T <= maxT; T++) {
+            table(R, T) = stats[R*(maxT+1) + T];
+            if (verbose(tracing::calcWilsonLoopTable)) std::cout << "(R,T) = (" << R << "," << T << "): " << table(R, T).mean << "+-" << table(R, T).std() << "\n";
+        }
+    }
+    return table;
 }
\ No newline at end of file
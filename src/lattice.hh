@@ -15,6 +15,7 @@
 #include <map>
 #include <bitset>
 #include <stdexcept>
+#include <algorithm>
 //XTensor
 #include "xtensor/xfixed.hpp"
 #include "xtensor/xtensor.hpp"
@@ -23,31 +24,68 @@
 #include "xtensor/xindex_view.hpp"
 //Project
 #include "misc.hh"
+#include "linkfield.hh"
+#include "su3.hh"
+#include "wilsonengine.hh"
+#include "plaquetteengine.hh"
+#include "temporalgauge.hh"
+#include "smearing.hh"
+#include "polyakov.hh"
+#include "pathengine.hh"
+#include "statistics.hh"
+#include "mappedfile.hh"
+#include "configfile.hh"
+#include "generator.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+#include "checkpoint.hh"
 
 class Lattice {
 	/*Class for holding a specific configuration and providing methods to load configs and compute plaquettes*/
 
 private:
 	std::array<size_t, 4> _shape;
-	lattice _config;
-	std::string _verbose;
-	std::string _debug;
+	LinkField _config;
+	uint32_t _verbose;
+	uint32_t _debug;
+	std::string _validation;
+	FixStats _fixes; //Links reunitarised by the last readConfig
+	bool _temporalGauge;
+
+	void printLinks();
+	void readNativeConfig(std::string);
+	bool verbose(tracing::Point point) const { return tracing::enabled(_verbose, point); }
+	bool debug(tracing::Point point) const { return tracing::enabled(_debug, point); }
 
 public:
-	Lattice(std::array<size_t, 4>, std::string, std::string, std::string);
+	Lattice(std::array<size_t, 4>, std::string, std::string, std::string, std::string, std::string);
 	~Lattice();
 	std::string getDim(size_t);
+	std::string getPoint(size_t);
 	void readConfig(std::string);
-	std::complex<double> calcPlaquette(std::array<size_t, 4>, std::pair<size_t, size_t>);
-	std::complex<double> calcMeanPlaquette(std::array<size_t, 4>);
-	std::array<size_t, 4> movePoint(std::array<size_t, 4>, size_t, int);
+	void generateConfig(const ConfigGenerator&);
+	void fixTemporalGauge();
+	void smearLinks(const SmearingParameters&);
+	bool isTemporalGauge();
+	su3Matrix getLink(size_t, size_t);
+	std::complex<double> calcPlaquette(size_t, std::pair<size_t, size_t>);
+	std::complex<double> calcMeanPlaquette(size_t);
+	size_t movePoint(size_t, size_t, int);
 	double getOverallPlaquetteMean();
-	std::complex<double> calcWilsonLoop(std::array<size_t, 4>, size_t, size_t, size_t);
-	std::complex<double> calcMeanWilsonLoopAtPoint(std::array<size_t, 4>, size_t, size_t);
+	PlaquetteStats calcPlaquetteStats();
+	std::complex<double> calcWilsonLoop(size_t, size_t, size_t, size_t);
+	std::complex<double> calcMeanWilsonLoopAtPoint(size_t, size_t, size_t);
 	std::pair<double, double> calcOverallMeanWilsonLoop(size_t, size_t);
 	double calcOverallMeanWilsonLoopMP(size_t, size_t);
+	RunningStats calcWilsonLoopStats(size_t, size_t);
+	std::vector<RunningStats> calcWilsonLoopStats(const std::vector<std::pair<size_t, size_t>>&);
+	xt::xtensor<RunningStats, 2> calcWilsonLoopTable(size_t, size_t, Checkpoint* checkpoint=nullptr);
 	xt::xtensor<double, 1> getWilsonLoopSample(size_t, size_t);
+	std::vector<PolyakovBin> calcPolyakovLoopCorrelator();
+	std::vector<RunningStats> calcPathStats(const std::vector<Path>&);
 	std::array<size_t, 4> getShape();
+	const LinkField& getLinks();
+	FixStats getFixStats() const { return _fixes; }
 
 	void test();
 };
@@ -0,0 +1,232 @@
+#include "linkfield.hh"
+
+LinkFormat parseLinkFormat(std::string name) {
+    /*Lookup link format from its command-line name*/
+    if (name == "double") return LinkFormat::full;
+    if (name == "tworow") return LinkFormat::twoRow;
+    if (name == "float") return LinkFormat::single;
+    if (name == "tworowfloat") return LinkFormat::twoRowSingle;
+    throw std::runtime_error("Unknown link format: " + name);
+}
+
+std::string getLinkFormatName(LinkFormat format) {
+    /*Command-line name of link format*/
+    if (format == LinkFormat::twoRow) return "tworow";
+    if (format == LinkFormat::single) return "float";
+    if (format == LinkFormat::twoRowSingle) return "tworowfloat";
+    return "double";
+}
+
+size_t getLinkBytes(LinkFormat format) {
+    /*Bytes used to store one link*/
+    if (format == LinkFormat::twoRow) return 6*sizeof(std::complex<double>);
+    if (format == LinkFormat::single) return 9*sizeof(std::complex<float>);
+    if (format == LinkFormat::twoRowSingle) return 6*sizeof(std::complex<float>);
+    return 9*sizeof(std::complex<double>);
+}
+
+double getLinkTolerance(LinkFormat format) {
+    /*Tolerance within which links that have been held in format are still special unitary*/
+    if (format == LinkFormat::single || format == LinkFormat::twoRowSingle) return 1e-5;
+    return 1e-10;
+}
+
+static inline std::complex<double> multiply(std::complex<double> a, std::complex<double> b) {
+    /*Complex product without the inf/NaN recovery of operator*, which is not inlined*/
+    return std::complex<double>(a.real()*b.real() - a.imag()*b.imag(), a.real()*b.imag() + a.imag()*b.real());
+}
+
+void encodeLink(LinkFormat format, const std::complex<double>* link, char* target) {
+    /*Write double-precision link in format*/
+    size_t nElements = (format == LinkFormat::twoRow || format == LinkFormat::twoRowSingle) ? 6 : LinkField::linkSize;
+
+    if (format == LinkFormat::full || format == LinkFormat::twoRow) {
+        memcpy(target, link, nElements*sizeof(std::complex<double>));
+    } else {
+        std::complex<float>* elements = reinterpret_cast<std::complex<float>*>(target);
+        for (size_t i = 0; i < nElements; i++) elements[i] = std::complex<float>(link[i]);
+    }
+}
+
+void decodeLink(LinkFormat format, const char* source, std::complex<double>* link) {
+    /*Expand link held in format to 9 double-precision elements. The third row of a two-row link is the complex
+    conjugate of the cross product of the first two, which holds exactly for SU(3)*/
+    bool twoRows = format == LinkFormat::twoRow || format == LinkFormat::twoRowSingle;
+    size_t nElements = twoRows ? 6 : LinkField::linkSize;
+
+    if (format == LinkFormat::full || format == LinkFormat::twoRow) {
+        memcpy(link, source, nElements*sizeof(std::complex<double>));
+    } else {
+        const std::complex<float>* elements = reinterpret_cast<const std::complex<float>*>(source);
+        for (size_t i = 0; i < nElements; i++) link[i] = std::complex<double>(elements[i]);
+    }
+
+    if (twoRows) {
+        link[6] = std::conj(multiply(link[1], link[5]) - multiply(link[2], link[4]));
+        link[7] = std::conj(multiply(link[2], link[3]) - multiply(link[0], link[5]));
+        link[8] = std::conj(multiply(link[0], link[4]) - multiply(link[1], link[3]));
+    }
+}
+
+LinkField::LinkField() : _shape({0, 0, 0, 0}), _volume(0), _format(LinkFormat::full), _linkBytes(0), _links(nullptr) { }
+
+LinkField::LinkField(std::array<size_t, 4> shape, LinkFormat format) : LinkField() {
+    allocate(shape, format);
+}
+
+LinkField::LinkField(LinkField&& other) : LinkField() {
+    *this = std::move(other);
+}
+
+LinkField& LinkField::operator=(LinkField&& other) {
+    /*Take ownership of other's storage*/
+    if (this != &other) {
+        release();
+        _shape = other._shape;
+        _volume = other._volume;
+        _format = other._format;
+        _linkBytes = other._linkBytes;
+        _links = other._links;
+        _forward = std::move(other._forward);
+        _backward = std::move(other._backward);
+        other._shape = {0, 0, 0, 0};
+        other._volume = 0;
+        other._links = nullptr;
+    }
+    return *this;
+}
+
+LinkField::~LinkField() {
+    release();
+}
+
+void LinkField::release() {
+    free(_links);
+    _links = nullptr;
+}
+
+void LinkField::allocate(std::array<size_t, 4> shape, LinkFormat format) {
+    /*Allocate aligned link storage for given shape and format, and tabulate neighbours*/
+    release();
+    _shape = shape;
+    _volume = _shape[0]*_shape[1]*_shape[2]*_shape[3];
+    if (_volume > UINT32_MAX) throw std::runtime_error("Lattice volume too large for 32-bit site indices");
+    _format = format;
+    _linkBytes = ::getLinkBytes(_format);
+
+    size_t bytes = getBytes();
+    bytes = ((bytes + alignment - 1)/alignment)*alignment; //Round up to whole cache lines
+    void* ptr = nullptr;
+    if (bytes > 0 && posix_memalign(&ptr, alignment, bytes) != 0) throw std::bad_alloc();
+    _links = static_cast<char*>(ptr);
+
+    firstTouch();
+    buildNeighbours();
+}
+
+void LinkField::firstTouch() {
+    /*Zero the storage from the threads that will measure it, so that each page is placed on the NUMA node of the thread
+    that reads it most. Each thread takes the contiguous range of (t,z) planes that the scheduler first gives it*/
+    const size_t nPlanes = _shape[2]*_shape[3];
+    const size_t planeBytes = 4*_shape[0]*_shape[1]*_linkBytes;
+    if (_links == nullptr) return;
+
+    #pragma omp parallel
+    {
+#ifdef _OPENMP
+        size_t thread = omp_get_thread_num(), nThreads = omp_get_num_threads();
+#else
+        size_t thread = 0, nThreads = 1;
+#endif
+        size_t begin = getPartBegin(nPlanes, thread, nThreads), end = getPartBegin(nPlanes, thread+1, nThreads);
+        memset(_links + begin*planeBytes, 0, (end - begin)*planeBytes);
+    }
+}
+
+size_t LinkField::index(std::array<size_t, 4> point) const {
+    /*Linear site index of point*/
+    return point[0] + _shape[0]*(point[1] + _shape[1]*(point[2] + _shape[2]*point[3]));
+}
+
+std::array<size_t, 4> LinkField::coordinates(size_t site) const {
+    /*Coordinates of linear site index*/
+    std::array<size_t, 4> point;
+    for (size_t d = 0; d < 4; d++) {
+        point[d] = site%_shape[d];
+        site /= _shape[d];
+    }
+    return point;
+}
+
+void buildNeighbourTables(std::array<size_t, 4> shape, std::vector<uint32_t>& forward, std::vector<uint32_t>& backward) {
+    /*Tabulate forward and backward neighbours in each direction of every site of shape with periodic boundaries,
+    neighbour of site in direction d at [4*site + d]*/
+    const size_t volume = shape[0]*shape[1]*shape[2]*shape[3];
+    const size_t strides[4] = {1, shape[0], shape[0]*shape[1], shape[0]*shape[1]*shape[2]};
+    forward.assign(4*volume, 0);
+    backward.assign(4*volume, 0);
+
+    for (size_t site = 0; site < volume; site++) {
+        for (size_t d = 0; d < 4; d++) {
+            size_t x = (site/strides[d])%shape[d];
+            forward[4*site + d] = static_cast<uint32_t>((x + 1 == shape[d]) ? site - x*strides[d] : site + strides[d]);
+            backward[4*site + d] = static_cast<uint32_t>((x == 0) ? site + (shape[d] - 1)*strides[d] : site - strides[d]);
+        }
+    }
+}
+
+void LinkField::buildNeighbours() {
+    /*Tabulate forward and backward neighbours of every site with periodic boundaries*/
+    buildNeighbourTables(_shape, _forward, _backward);
+}
+
+void LinkField::store(size_t site, size_t dir, const std::complex<double>* link) {
+    /*Write double-precision link in the storage format*/
+    encodeLink(_format, link, _links + (4*site + dir)*_linkBytes);
+}
+
+size_t LinkField::load(const std::complex<double>* source, size_t firstSlice, size_t nSlices, bool validate, FixStats* fixes, double tolerance) {
+    /*Store nSlices timeslices of double-precision links, held in file order in source, from timeslice firstSlice onwards.
+    Links are stored and optionally validated in parallel. Given fixes, links that fail validation are reunitarised
+    before being stored and added to fixes, and only links that cannot be projected, such as those holding NaN, count
+    as invalid. Links read from single-precision storage are checked with a looser tolerance. Returns the position in source of the first invalid link, or the number of links read if every link is valid*/
+    const size_t spatialVolume = getSpatialVolume();
+    const size_t firstSite = firstSlice*spatialVolume;
+    const size_t nSites = nSlices*spatialVolume;
+    size_t firstInvalid = 4*nSites;
+
+    #pragma omp parallel reduction(min:firstInvalid)
+    {
+        FixStats threadFixes;
+        #pragma omp for schedule(static)
+        for (size_t site = 0; site < nSites; site++) {
+            for (size_t d = 0; d < 4; d++) {
+                const std::complex<double>* link = source + (4*site + d)*linkSize;
+                if (validate && !su3::isSpecialUnitary(link, tolerance)) {
+                    if (fixes == nullptr) {
+                        firstInvalid = std::min(firstInvalid, 4*site + d);
+                    } else {
+                        std::complex<double> fixed[linkSize];
+                        std::copy(link, link + linkSize, fixed);
+                        su3::reunitarise(fixed);
+                        if (!su3::isSpecialUnitary(fixed)) firstInvalid = std::min(firstInvalid, 4*site + d);
+                        threadFixes.add(link, fixed);
+                        store(firstSite + site, d, fixed);
+                        continue;
+                    }
+                }
+                store(firstSite + site, d, link);
+            }
+        }
+        if (fixes != nullptr) {
+            #pragma omp critical
+            fixes->merge(threadFixes);
+        }
+    }
+    return firstInvalid;
+}
+
+void LinkField::decode(size_t site, size_t dir, std::complex<double>* link) const {
+    /*Expand compressed link to 9 double-precision elements*/
+    decodeLink(_format, _links + (4*site + dir)*_linkBytes, link);
+}
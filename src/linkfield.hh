@@ -0,0 +1,122 @@
+#ifndef LINKFIELD_HH_
+#define LINKFIELD_HH_
+
+//C++
+#include <array>
+#include <complex>
+#include <vector>
+#include <string>
+#include <utility>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+#include <algorithm>
+//Project
+#include "su3.hh"
+#include "scheduler.hh"
+
+enum class LinkFormat {
+	/*In-memory representation of each link*/
+	full, //9 complex doubles
+	twoRow, //First two rows as 6 complex doubles, third row rebuilt from unitarity
+	single, //9 complex floats
+	twoRowSingle //First two rows as 6 complex floats
+};
+
+struct FixStats {
+	/*Links projected back onto SU(3) while loading, and how far they were from it*/
+	size_t count;
+	double maxDeviation; //Largest element of U.U^dagger - 1 or |det U - 1| before projection
+	double maxChange; //Largest change of an element made by projection
+	double sumChange; //Sum over fixed links of their largest element change
+
+	FixStats() : count(0), maxDeviation(0.), maxChange(0.), sumChange(0.) { }
+
+	void add(const std::complex<double>* before, const std::complex<double>* after) {
+		double change = 0;
+		for (size_t i = 0; i < 9; i++) change = std::max(change, std::abs(after[i] - before[i]));
+		count++;
+		maxDeviation = std::max(maxDeviation, std::max(su3::unitarityDeviation(before), std::abs(su3::det(before) - 1.)));
+		maxChange = std::max(maxChange, change);
+		sumChange += change;
+	}
+
+	void merge(const FixStats& other) {
+		count += other.count;
+		maxDeviation = std::max(maxDeviation, other.maxDeviation);
+		maxChange = std::max(maxChange, other.maxChange);
+		sumChange += other.sumChange;
+	}
+
+	double meanChange() const { return (count > 0) ? sumChange/count : 0.; }
+};
+
+LinkFormat parseLinkFormat(std::string);
+std::string getLinkFormatName(LinkFormat);
+size_t getLinkBytes(LinkFormat);
+double getLinkTolerance(LinkFormat);
+void encodeLink(LinkFormat, const std::complex<double>*, char*);
+void decodeLink(LinkFormat, const char*, std::complex<double>*);
+void buildNeighbourTables(std::array<size_t, 4>, std::vector<uint32_t>&, std::vector<uint32_t>&);
+
+class LinkField {
+	/*Contiguous, 64-byte aligned storage of the four SU(3) links at every lattice site.
+	Sites are indexed linearly as x + Nx*(y + Ny*(z + Nz*t)), i.e. the order in which configurations are stored on disk,
+	and each link is 9 complex numbers in row-major order. Forward and backward neighbours of every site in all four
+	directions are tabulated once so that walking the lattice never needs a periodic modulo.
+	Links may be held in a compressed format, in which case fetch decodes them to double precision on the fly*/
+
+private:
+	std::array<size_t, 4> _shape;
+	size_t _volume;
+	LinkFormat _format;
+	size_t _linkBytes;
+	char* _links;
+	std::vector<uint32_t> _forward;
+	std::vector<uint32_t> _backward;
+
+	void buildNeighbours();
+	void firstTouch();
+	void release();
+	void decode(size_t, size_t, std::complex<double>*) const;
+
+public:
+	static constexpr size_t alignment = 64;
+	static constexpr size_t linkSize = 9;
+
+	LinkField();
+	LinkField(std::array<size_t, 4>, LinkFormat format=LinkFormat::full);
+	LinkField(LinkField&&);
+	LinkField& operator=(LinkField&&);
+	LinkField(const LinkField&) = delete;
+	LinkField& operator=(const LinkField&) = delete;
+	~LinkField();
+
+	void allocate(std::array<size_t, 4>, LinkFormat format=LinkFormat::full);
+	std::array<size_t, 4> getShape() const { return _shape; }
+	size_t getVolume() const { return _volume; }
+	size_t getSpatialVolume() const { return _shape[0]*_shape[1]*_shape[2]; }
+	LinkFormat getFormat() const { return _format; }
+	size_t getBytes() const { return 4*_volume*_linkBytes; }
+	size_t getLinkBytes() const { return _linkBytes; }
+	size_t getSliceBytes() const { return 4*getSpatialVolume()*_linkBytes; }
+	char* getSlice(size_t t) { return _links + t*getSliceBytes(); }
+
+	size_t index(std::array<size_t, 4>) const;
+	std::array<size_t, 4> coordinates(size_t) const;
+
+	size_t next(size_t site, size_t dir) const { return _forward[4*site + dir]; }
+	size_t prev(size_t site, size_t dir) const { return _backward[4*site + dir]; }
+
+	const std::complex<double>* fetch(size_t site, size_t dir, std::complex<double>* scratch) const {
+		/*Pointer to link in double precision; compressed links are decoded into the 9-element scratch buffer*/
+		if (_format == LinkFormat::full) return reinterpret_cast<const std::complex<double>*>(_links + (4*site + dir)*_linkBytes);
+		decode(site, dir, scratch);
+		return scratch;
+	}
+	void store(size_t, size_t, const std::complex<double>*);
+	size_t load(const std::complex<double>*, size_t, size_t, bool, FixStats* fixes=nullptr, double tolerance=1e-10);
+};
+
+#endif /* LINKFIELD_HH_ */
@@ -4,14 +4,32 @@ std::string debug = "";
 std::string verbose = "";
 std::string defaultInput = "./Data/SU3_24_24_24_48_6.2000_1000_PHB_4_OR_7_dp.bin";
 std::string defaultOutput = "Output/SU3_24_24_24_48_6.2000_1000_PHB_4_OR_7_dp.csv";
-constexpr std::array<size_t, 4> param_Grid = {24, 24, 24, 48};
+std::string defaultShapes = "1,0,0;1,1,0;1,1,1;2,0,0;2,1,0;2,1,1;2,2,0;2,2,1;3,0,0";
+std::array<size_t, 4> param_Grid;
+std::unique_ptr<Checkpoint> checkpoint;
 
 void showHelp() {
     /*Show help for input arguments*/
-    std::cout << "-i : Input file name, default " << defaultInput << "\n";
-    std::cout << "-o : Output file name, default " << defaultOutput << "\n";
+    std::cout << "-i : Input file name, or comma-separated list of files and glob patterns for multi-config mode, default " << defaultInput << "\n";
+    std::cout << "-o : Output file name, default " << defaultOutput << ". In multi-config mode with separate outputs, the directory for per-config files\n";
+    std::cout << "-m : Multi-config output [separate/combined], default separate\n";
+    std::cout << "-g : Lattice shape Nx,Ny,Nz,Nt, default read from the header of a native input, else from <input>.shape if present, else from the SU3_Nx_Ny_Nz_Nt_ pattern of the input name\n";
     std::cout << "-d : Run in debug point, default none\n";
     std::cout << "-v : Run in verbose point, default off\n";
+    std::cout << "-u : Link validation on load [check/trust/fix], default check. Fix reunitarises non-unitary links instead of aborting\n";
+    std::cout << "-f : In-memory link format [double/tworow/float/tworowfloat], default double\n";
+    std::cout << "-t : Gauge transformation before measuring [none/temporal], default none\n";
+    std::cout << "-n : Smearing of spatial links before measuring [none/ape:<iterations>[:<alpha>]/hyp:<iterations>[:<alpha1>,<alpha2>]], default none. Alphas default to 0.5 for APE and 0.6,0.3 for HYP\n";
+    std::cout << "-e : Experiment [wilson/polyakov/paths], default wilson. Paths measures Wilson loops of the spatial shapes -l in every orientation\n";
+    std::cout << "-l : Spatial loop shapes for -e paths as dx,dy,dz separated by ';', default " << defaultShapes << "\n";
+    std::cout << "-s : Multi-config Wilson loop jackknife output file, default none\n";
+    std::cout << "-b : Number of consecutive configs per jackknife block, default 1\n";
+    std::cout << "-r : Wilson loop result format [csv/binary], default csv. Binary appends one record per config to the single file -o\n";
+    std::cout << "-p : Per-phase timing summary at exit [off/print/<file>], default off. A file name writes the summary as CSV\n";
+    std::cout << "-w : Stream Wilson loops through a window of this many base timeslices plus Nt/4 instead of loading whole configs, default 0 (off)\n";
+    std::cout << "-a : Thread affinity [none/compact/spread], default none. Compact fills one NUMA node before the next, spread alternates between them\n";
+    std::cout << "-c : Checkpoint file recording finished configs and timeslice blocks, so that a killed run restarted with the same arguments resumes, default none\n";
+    std::cout << "-x : Number of configs whose Wilson loops are measured at once in multi-config mode, one per vector lane, default 1. 4 fills AVX2 registers, 8 AVX-512\n";
 }
 
 std::map<std::string, std::string> getOptions(int argc, char* argv[]) {
@@ -21,6 +39,22 @@ std::map<std::string, std::string> getOptions(int argc, char* argv[]) {
     options.insert(std::make_pair("-o", defaultOutput)); //Output name
     options.insert(std::make_pair("-d", "")); //Debug mode
     options.insert(std::make_pair("-v", "")); //Verbose mode
+    options.insert(std::make_pair("-u", "check")); //Link validation
+    options.insert(std::make_pair("-f", "double")); //Link format
+    options.insert(std::make_pair("-m", "separate")); //Multi-config output
+    options.insert(std::make_pair("-g", "")); //Lattice shape
+    options.insert(std::make_pair("-t", "none")); //Gauge transformation
+    options.insert(std::make_pair("-n", "none")); //Smearing
+    options.insert(std::make_pair("-e", "wilson")); //Experiment
+    options.insert(std::make_pair("-s", "")); //Ensemble statistics
+    options.insert(std::make_pair("-b", "1")); //Jackknife block size
+    options.insert(std::make_pair("-r", "csv")); //Result format
+    options.insert(std::make_pair("-p", "off")); //Timing summary
+    options.insert(std::make_pair("-l", defaultShapes)); //Loop shapes
+    options.insert(std::make_pair("-c", "")); //Checkpoint file
+    options.insert(std::make_pair("-w", "0")); //Streaming window
+    options.insert(std::make_pair("-a", "none")); //Thread affinity
+    options.insert(std::make_pair("-x", "1")); //Configs per batch
 
     if (argc >= 2) { //Check if help was requested
         std::string option(argv[1]);
@@ -45,45 +79,420 @@ std::map<std::string, std::string> getOptions(int argc, char* argv[]) {
 }
 
 void runWilsonExperiment(Lattice* config, std::string name) {
-    /*Loop over range of R and T values and compute mean of corresponding Wilson loops*/
+    /*Compute mean of Wilson loops over range of R and T values loop by loop, with all (R,T) sharing one parallel pass*/
     std::ofstream outFile;
     outFile.precision(50);
     outFile.open(name);
-    outFile << "R,T,Mean,Std\n";
+    outFile << "R,T,Mean,Std,Count\n";
 
-    std::pair<double, double> mean;
-    for (size_t R = 1; R <= 2; config->getShape()[0]/2; R++) {
-        for (size_t T = 1; T <= 2; config->getShape()[3]/4; T++) {
-            if (verbose != "") std::cout << "(R, T) = " << R << ", " << T << ", mean = ";
-            mean = config->calcOverallMeanWilsonLoop(R, T);
-            outFile << R << "," << T << "," << mean.first << "," << mean.second << "\n";
-            if (verbose != "") std::cout << mean.first << "+-" << mean.second << "\n";
+    std::vector<std::pair<size_t, size_t>> sizes;
+    for (size_t R = 1; R <= config->getShape()[0]/2; R++) {
+        for (size_t T = 1; T <= config->getShape()[3]/4; T++) sizes.push_back(std::make_pair(R, T));
+    }
+    std::vector<RunningStats> stats = config->calcWilsonLoopStats(sizes);
+
+    timing::Timer timer(timing::Phase::output);
+    for (size_t s = 0; s < sizes.size(); s++) {
+        outFile << sizes[s].first << "," << sizes[s].second << "," << stats[s].mean << "," << stats[s].std() << "," << stats[s].count << "\n";
+        if (verbose != "") std::cout << "(R, T) = " << sizes[s].first << ", " << sizes[s].second << ", mean = " << stats[s].mean << "+-" << stats[s].std() << "\n";
+    }
+
+    outFile.close();
+}
+
+template <class Config>
+xt::xtensor<RunningStats, 2> writeWilsonTable(Config* config, std::ostream& outFile, std::string prefix) {
+    /*Compute statistics of Wilson loops for the whole range of R and T values in a single multi-processing pass and write rows starting with prefix*/
+    size_t maxR = config->getShape()[0]/2;
+    size_t maxT = config->getShape()[3]/4;
+    xt::xtensor<RunningStats, 2> table = config->calcWilsonLoopTable(maxR, maxT, checkpoint.get());
+    timing::Timer timer(timing::Phase::output);
+    for (size_t R = 1; R <= maxR; R++) {
+        for (size_t T = 1; T <= maxT; T++) {
+            outFile << prefix << R << "," << T << "," << table(R, T).mean << "," << table(R, T).std() << "," << table(R, T).count << "\n";
+            if (verbose != "") std::cout << "(R, T) = " << R << ", " << T << ", mean = " << table(R, T).mean << "+-" << table(R, T).std() << "\n";
         }
     }
+    return table;
+}
 
+template <class Config>
+xt::xtensor<RunningStats, 2> runWilsonExperimentMP(Config* config, std::string name) {
+    /*Compute statistics of Wilson loops for the whole range of R and T values in a single multi-processing pass*/
+    std::ofstream outFile;
+    outFile.precision(50);
+    outFile.open(name);
+    outFile << "R,T,Mean,Std,Count\n";
+    xt::xtensor<RunningStats, 2> table = writeWilsonTable(config, outFile, "");
     outFile.close();
+    return table;
+}
+
+std::vector<RunningStats> flattenTable(const xt::xtensor<RunningStats, 2>& table, size_t maxR, size_t maxT) {
+    /*Wilson loop statistics indexed by R*(maxT+1) + T*/
+    std::vector<RunningStats> stats((maxR+1)*(maxT+1));
+    for (size_t R = 0; R <= maxR; R++) {
+        for (size_t T = 0; T <= maxT; T++) stats[R*(maxT+1) + T] = table(R, T);
+    }
+    return stats;
+}
+
+template <class Config>
+xt::xtensor<RunningStats, 2> runWilsonExperimentBinary(Config* config, ResultFile& results, std::string name) {
+    /*Compute statistics of Wilson loops for the whole range of R and T values and append them to results under name*/
+    size_t maxR = config->getShape()[0]/2;
+    size_t maxT = config->getShape()[3]/4;
+    xt::xtensor<RunningStats, 2> table = config->calcWilsonLoopTable(maxR, maxT, checkpoint.get());
+    timing::Timer timer(timing::Phase::output);
+    results.append(name, flattenTable(table, maxR, maxT));
+    return table;
+}
+
+void writeEnsembleStats(const EnsembleStats& ensemble, std::string name, size_t blockSize) {
+    /*Write jackknife means and errors of the Wilson loops and effective potential over the ensemble, with the column names of the analysis notebook*/
+    std::vector<JackknifeEstimate> estimates = ensemble.calcJackknife(blockSize);
+    timing::Timer timer(timing::Phase::output);
+    std::ofstream outFile;
+    outFile.precision(17);
+    outFile.open(name);
+    outFile << "R,T,Mean_W,Std_W,Mean_V,Std_V\n";
+    for (size_t R = 1; R <= param_Grid[0]/2; R++) {
+        for (size_t T = 1; T <= param_Grid[3]/4; T++) {
+            const JackknifeEstimate& estimate = estimates[ensemble.index(R, T)];
+            outFile << R << "," << T << "," << estimate.meanW << "," << estimate.errorW << "," << estimate.meanV << "," << estimate.errorV << "\n";
+        }
+    }
+    outFile.close();
+}
+
+void writePolyakovTable(Lattice* config, std::ostream& outFile, std::string prefix) {
+    /*Compute Polyakov loop correlator binned by separation and write rows starting with prefix.
+    The static potential is estimated as -ln(C(r))/Nt in lattice units*/
+    std::vector<PolyakovBin> bins = config->calcPolyakovLoopCorrelator();
+    timing::Timer timer(timing::Phase::output);
+    for (const PolyakovBin& bin : bins) {
+        double potential = -std::log(bin.correlator)/config->getShape()[3];
+        outFile << prefix << bin.r2 << "," << std::sqrt(bin.r2) << "," << bin.count << "," << bin.correlator << "," << potential << "\n";
+        if (verbose != "") std::cout << "|r| = " << std::sqrt(bin.r2) << ", correlator = " << bin.correlator << "\n";
+    }
 }
 
-void runWilsonExperimentMP(Lattice* config, std::string name) {
-    /*Loop over range of R and T values and compute mean of corresponding Wilson loops*/
+void runPolyakovExperiment(Lattice* config, std::string name) {
+    /*Compute Polyakov loop correlator for all spatial separations by FFT and write it binned by |r|*/
     std::ofstream outFile;
     outFile.precision(50);
     outFile.open(name);
-    outFile << "R,T,Mean\n";
+    outFile << "R2,R,Count,Correlator,Potential\n";
+    writePolyakovTable(config, outFile, "");
+    outFile.close();
+}
 
-    double mean;
-    for (size_t R = 1; R <= config->getShape()[0]/2; R++) {
-        for (size_t T = 1; T <= config->getShape()[3]/4; T++) {
-            if (verbose != "") std::cout << "(R, T) = " << R << ", " << T << ", mean = ";
-            mean = config->calcOverallMeanWilsonLoopMP(R, T);
-            outFile << R << "," << T << "," << mean << "\n";
-            if (verbose != "") std::cout << mean << "\n";
+std::vector<std::array<int, 3>> parseLoopShapes(std::string text) {
+    /*Spatial displacements dx,dy,dz separated by ';'*/
+    std::vector<std::array<int, 3>> shapes;
+    std::stringstream stream(text);
+    std::string entry;
+    while (std::getline(stream, entry, ';')) {
+        if (entry == "") continue;
+        std::array<int, 3> shape;
+        char comma[2];
+        std::stringstream fields(entry);
+        if (!(fields >> shape[0] >> comma[0] >> shape[1] >> comma[1] >> shape[2]) || comma[0] != ',' || comma[1] != ',' || shape == std::array<int, 3>{0, 0, 0}) {
+            throw std::runtime_error("Invalid loop shape: " + entry);
         }
+        shapes.push_back(shape);
     }
+    return shapes;
+}
 
+void writePathTable(Lattice* config, std::ostream& outFile, std::string prefix, const std::vector<std::array<int, 3>>& shapes) {
+    /*Compute Wilson loops with each spatial shape, averaged over its orientations, for T up to Nt/4 and write rows starting with prefix.
+    Every loop is evaluated in one pass over the lattice so that loops of the same orientation share their spatial line*/
+    size_t maxT = config->getShape()[3]/4;
+    std::vector<Path> paths;
+    std::vector<size_t> groups; //Output row of each path
+    for (size_t s = 0; s < shapes.size(); s++) {
+        std::vector<std::array<int, 3>> orientations = getOrientations(shapes[s]);
+        for (size_t T = 1; T <= maxT; T++) {
+            for (const std::array<int, 3>& r : orientations) {
+                paths.push_back(makeWilsonPath(r, T));
+                groups.push_back(s*maxT + T-1);
+            }
+        }
+    }
+
+    std::vector<RunningStats> stats = config->calcPathStats(paths);
+    std::vector<RunningStats> rows(shapes.size()*maxT);
+    for (size_t p = 0; p < paths.size(); p++) rows[groups[p]].merge(stats[p]);
+
+    timing::Timer timer(timing::Phase::output);
+    for (size_t s = 0; s < shapes.size(); s++) {
+        double R = std::sqrt(shapes[s][0]*shapes[s][0] + shapes[s][1]*shapes[s][1] + shapes[s][2]*shapes[s][2]);
+        for (size_t T = 1; T <= maxT; T++) {
+            const RunningStats& row = rows[s*maxT + T-1];
+            outFile << prefix << shapes[s][0] << "," << shapes[s][1] << "," << shapes[s][2] << "," << R << "," << T << "," << row.mean << "," << row.std() << "," << row.count << "\n";
+            if (verbose != "") std::cout << "r = (" << shapes[s][0] << "," << shapes[s][1] << "," << shapes[s][2] << "), T = " << T << ", mean = " << row.mean << "+-" << row.std() << "\n";
+        }
+    }
+}
+
+void runPathExperiment(Lattice* config, std::string name, const std::vector<std::array<int, 3>>& shapes) {
+    /*Compute Wilson loops of general spatial shape and write them with their displacement and length*/
+    std::ofstream outFile;
+    outFile.precision(50);
+    outFile.open(name);
+    outFile << "DX,DY,DZ,R,T,Mean,Std,Count\n";
+    writePathTable(config, outFile, "", shapes);
     outFile.close();
 }
 
+std::vector<std::string> expandInputs(std::string inputs) {
+    /*Split comma-separated list of files and glob patterns into sorted file names*/
+    std::vector<std::string> names;
+    std::stringstream stream(inputs);
+    std::string pattern;
+    while (std::getline(stream, pattern, ',')) {
+        if (pattern == "") continue;
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) names.push_back(matches.gl_pathv[i]);
+        } else {
+            names.push_back(pattern); //No match, leave loading to report the missing file
+        }
+        globfree(&matches);
+    }
+    return names;
+}
+
+std::string getStem(std::string name) {
+    /*File name without directory or extension*/
+    name = name.substr(name.find_last_of('/') + 1);
+    return name.substr(0, name.find_last_of('.'));
+}
+
+std::string getOutputDirectory(std::string output) {
+    /*Output itself if it is a directory, otherwise the directory containing it*/
+    struct stat info;
+    if (stat(output.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) return output;
+    size_t slash = output.find_last_of('/');
+    return (slash == std::string::npos) ? "." : output.substr(0, slash);
+}
+
+size_t getFileSize(std::string name) {
+    /*Size of a file in bytes, zero if it does not exist*/
+    struct stat info;
+    return (stat(name.c_str(), &info) == 0) ? static_cast<size_t>(info.st_size) : 0;
+}
+
+void openCheckpoint(std::map<std::string, std::string> options, const std::vector<std::string>& inputs) {
+    /*Open the checkpoint file -c, identified by every argument that affects the results and by the expanded inputs.
+    A binary result file is cut back to the records of finished configs, dropping any appended by a config that was interrupted*/
+    std::stringstream arguments;
+    for (const auto& option : options) {
+        if (option.first != "-c" && option.first != "-d" && option.first != "-v" && option.first != "-p" && option.first != "-a") arguments << option.first << "=" << option.second << ";";
+    }
+    for (size_t d = 0; d < 4; d++) arguments << param_Grid[d] << ",";
+    for (const std::string& input : inputs) arguments << ";" << input;
+
+    bool binary = options["-r"] == "binary";
+    checkpoint.reset(new Checkpoint(options["-c"], checksum::hash(arguments.str()), binary ? getFileSize(options["-o"]) : 0));
+    std::cout << "Checkpointing to " << options["-c"] << ", " << checkpoint->getConfigs().size() << " configs already measured\n";
+    if (binary) {
+        size_t size = getFileSize(options["-o"]);
+        if (size < checkpoint->getResultBytes()) throw std::runtime_error("Result file " + options["-o"] + " is shorter than recorded in checkpoint " + options["-c"]);
+        if (size > checkpoint->getResultBytes() && truncate(options["-o"].c_str(), checkpoint->getResultBytes()) != 0) throw std::runtime_error("Could not truncate result file: " + options["-o"]);
+    }
+}
+
+void loadConfig(Lattice* config, std::string name, std::string gauge, SmearingParameters smearing) {
+    /*Read configuration into existing lattice on a background thread, leaving most cores to the measurement in progress*/
+    topology::releaseThread();
+#ifdef _OPENMP
+    omp_set_num_threads(std::max(1, omp_get_num_procs()/4));
+#endif
+    config->readConfig(name);
+    config->smearLinks(smearing);
+    if (gauge == "temporal") config->fixTemporalGauge();
+}
+
+struct BatchLane {
+    /*Wilson loop statistics of one lane of a measured LinkBatch, standing in for its configuration in the Wilson loop
+    output functions*/
+    std::array<size_t, 4> shape;
+    const std::vector<RunningStats>& stats;
+
+    std::array<size_t, 4> getShape() const { return shape; }
+    xt::xtensor<RunningStats, 2> calcWilsonLoopTable(size_t maxR, size_t maxT, Checkpoint*) const {
+        xt::xtensor<RunningStats, 2> table = xt::xtensor<RunningStats, 2>(std::array<size_t, 2>{maxR+1, maxT+1});
+        for (size_t R = 0; R <= maxR; R++) {
+            for (size_t T = 0; T <= maxT; T++) table(R, T) = stats[R*(maxT+1) + T];
+        }
+        return table;
+    }
+};
+
+void runEnsemble(std::vector<std::string> inputs, std::map<std::string, std::string> options) {
+    /*Measure every configuration in one process. The next configuration is read and validated into a second
+    lattice while the current one is measured, then the two buffers are swapped. When streaming, each configuration is
+    instead read through the window as it is measured. With -x, Wilson loops are measured for a batch of that many
+    configurations at once: each loaded configuration is copied into the next lane of a LinkBatch, and the batch is
+    measured when every lane is filled or the configurations run out. Configs that the checkpoint records as finished
+    are not read again, and their rows and means are restored from it*/
+    bool polyakov = options["-e"] == "polyakov";
+    bool paths = options["-e"] == "paths";
+    std::vector<std::array<int, 3>> shapes = parseLoopShapes(options["-l"]);
+    bool binary = options["-r"] == "binary";
+    bool combined = options["-m"] == "combined" && !binary;
+    std::string directory = getOutputDirectory(options["-o"]);
+    std::unique_ptr<ResultFile> results;
+    if (binary) results.reset(new ResultFile(options["-o"], param_Grid, param_Grid[0]/2, param_Grid[3]/4));
+    std::ofstream combinedFile;
+    if (combined) {
+        combinedFile.precision(50);
+        combinedFile.open(options["-o"]);
+        if (polyakov) combinedFile << "Config,R2,R,Count,Correlator,Potential\n";
+        else if (paths) combinedFile << "Config,DX,DY,DZ,R,T,Mean,Std,Count\n";
+        else combinedFile << "Config,R,T,Mean,Std,Count\n";
+    }
+
+    const size_t maxR = param_Grid[0]/2, maxT = param_Grid[3]/4;
+    bool collect = options["-s"] != "" && !polyakov && !paths;
+    EnsembleStats ensemble(maxR, maxT);
+
+    std::vector<size_t> pending; //Configs still to measure
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (checkpoint == nullptr || !checkpoint->isComplete(i)) pending.push_back(i);
+    }
+    if (checkpoint != nullptr) {
+        for (const auto& config : checkpoint->getConfigs()) { //Loop over finished configs in order
+            if (combined) combinedFile << config.second.rows;
+            if (collect) ensemble.add(config.second.means);
+        }
+    }
+
+    bool streaming = options["-w"] != "0";
+    const size_t lanes = std::stoul(options["-x"]);
+    std::unique_ptr<LinkBatch> batch;
+    std::vector<size_t> batched; //Configs in the lanes of the batch, in lane order
+    if (lanes > 1) {
+        batch.reset(new LinkBatch(param_Grid, lanes));
+        std::cout << "Measuring Wilson loops of " << lanes << " configs at once using " << batch->getBytes()/(1024.*1024.) << " MB of lane-interleaved links\n";
+    }
+    SmearingParameters smearing = parseSmearing(options["-n"]);
+    std::unique_ptr<StreamingLattice> stream;
+    std::unique_ptr<Lattice> current, next;
+    std::future<void> loading;
+    if (streaming) {
+        stream.reset(new StreamingLattice(param_Grid, std::stoul(options["-w"]), maxT, verbose, options["-u"], options["-f"]));
+        stream->setSmearing(smearing);
+    } else {
+        current.reset(new Lattice(param_Grid, "", verbose, debug, options["-u"], options["-f"]));
+        next.reset(new Lattice(param_Grid, "", verbose, debug, options["-u"], options["-f"]));
+        if (pending.size() > 0) loading = std::async(std::launch::async, loadConfig, next.get(), inputs[pending[0]], options["-t"], smearing);
+    }
+
+    auto measureWilson = [&](size_t i, auto* config) {
+        /*Measure the Wilson loops of config i, write them and record the config as finished*/
+        std::ostringstream rows; //Rows of the combined file, written once the config is finished
+        rows.precision(50);
+        std::vector<double> means;
+        xt::xtensor<RunningStats, 2> table = binary ? runWilsonExperimentBinary(config, *results, getStem(inputs[i]))
+                                           : combined ? writeWilsonTable(config, rows, getStem(inputs[i]) + ",")
+                                           : runWilsonExperimentMP(config, directory + "/" + getStem(inputs[i]) + ".csv");
+        if (collect) {
+            std::vector<RunningStats> stats = flattenTable(table, maxR, maxT);
+            means.resize(stats.size());
+            for (size_t e = 0; e < stats.size(); e++) means[e] = stats[e].mean;
+            ensemble.add(means);
+        }
+        if (combined) combinedFile << rows.str() << std::flush;
+        if (checkpoint != nullptr) checkpoint->addConfig(i, ConfigRecord{getStem(inputs[i]), binary ? getFileSize(options["-o"]) : 0, means, rows.str()});
+    };
+
+    auto measureBatch = [&]() {
+        /*Measure every config in the batch at once, then write each as if it had been measured alone*/
+        if (batched.size() == 0) return;
+        std::cout << "Running Wilson loop experiment on " << batched.size() << " configs at once:";
+        for (size_t i : batched) std::cout << " " << i+1;
+        std::cout << " of " << inputs.size() << "\n";
+        BatchWilsonEngine engine(*batch, maxR, maxT);
+        timing::Timer timer(timing::Phase::wilsonTable);
+        std::vector<std::vector<RunningStats>> stats = engine.calcStats();
+        timer.count(engine.getWork());
+        timer.stop();
+        for (size_t l = 0; l < batched.size(); l++) {
+            BatchLane lane{param_Grid, stats[l]};
+            measureWilson(batched[l], &lane);
+        }
+        batched.clear();
+    };
+
+    size_t nFailed = 0;
+    for (size_t k = 0; k < pending.size(); k++) {
+        size_t i = pending[k];
+        bool loaded = true;
+        try {
+            timing::Timer timer(timing::Phase::loadWait);
+            if (streaming) stream->readConfig(inputs[i]);
+            else loading.get();
+        } catch (std::exception& e) {
+            std::cout << "Failed to load config " << inputs[i] << ": " << e.what() << std::endl;
+            loaded = false;
+            nFailed++;
+        }
+        if (!streaming) {
+            std::swap(current, next);
+            if (k+1 < pending.size()) loading = std::async(std::launch::async, loadConfig, next.get(), inputs[pending[k+1]], options["-t"], smearing);
+        }
+        if (!loaded) continue;
+
+        if (batch != nullptr) {
+            batch->setLane(batched.size(), current->getLinks());
+            batched.push_back(i);
+            if (batched.size() == lanes) measureBatch();
+            continue;
+        }
+
+        std::cout << "Running " << (polyakov ? "Polyakov loop" : paths ? "loop shape" : "Wilson loop") << " experiment on config " << i+1 << " of " << inputs.size() << ": " << inputs[i] << "\n";
+        if (checkpoint != nullptr) checkpoint->setConfig(i);
+        std::ostringstream rows; //Rows of the combined file, written once the config is finished
+        rows.precision(50);
+        std::vector<double> means;
+        if (polyakov) {
+            if (combined) {
+                writePolyakovTable(current.get(), rows, getStem(inputs[i]) + ",");
+            } else {
+                runPolyakovExperiment(current.get(), directory + "/" + getStem(inputs[i]) + ".csv");
+            }
+        } else if (paths) {
+            if (combined) {
+                writePathTable(current.get(), rows, getStem(inputs[i]) + ",", shapes);
+            } else {
+                runPathExperiment(current.get(), directory + "/" + getStem(inputs[i]) + ".csv", shapes);
+            }
+        } else {
+            if (streaming) measureWilson(i, stream.get());
+            else measureWilson(i, current.get());
+            continue;
+        }
+
+        if (combined) combinedFile << rows.str() << std::flush;
+        if (checkpoint != nullptr) checkpoint->addConfig(i, ConfigRecord{getStem(inputs[i]), binary ? getFileSize(options["-o"]) : 0, means, rows.str()});
+    }
+    measureBatch(); //Configs left in a partly filled batch
+
+    if (combined) combinedFile.close();
+    std::cout << inputs.size() - nFailed << " of " << inputs.size() << " configs measured\n";
+    if (collect) {
+        std::cout << "Writing jackknife estimates over " << ensemble.getConfigs() << " configs in blocks of " << options["-b"] << " to: " << options["-s"] << "\n";
+        try {
+            writeEnsembleStats(ensemble, options["-s"], std::stoul(options["-b"]));
+        } catch (std::exception& e) {
+            std::cout << "Could not compute jackknife estimates: " << e.what() << std::endl;
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
     std::map<std::string, std::string> options = getOptions(argc, argv); //Get parsed arguments
     if (options.size() == 0) {
@@ -91,10 +500,74 @@ int main(int argc, char *argv[]) {
     }
     debug = options["-d"];
     verbose = options["-v"];
+    timing::Summary summary(options["-p"]);
+    topology::report(std::cout, options["-a"], topology::pinThreads(options["-a"]));
+    if (options["-t"] != "none" && options["-t"] != "temporal") throw std::runtime_error("Unknown gauge transformation: " + options["-t"]);
+    SmearingParameters smearing = parseSmearing(options["-n"]);
+    if (options["-e"] != "wilson" && options["-e"] != "polyakov" && options["-e"] != "paths") throw std::runtime_error("Unknown experiment: " + options["-e"]);
+    if (options["-r"] != "csv" && options["-r"] != "binary") throw std::runtime_error("Unknown result format: " + options["-r"]);
+    if (options["-r"] == "binary" && options["-e"] != "wilson") throw std::runtime_error("Binary results are only available for Wilson loops");
+    if (options["-w"] != "0" && (options["-e"] != "wilson" || options["-t"] != "none")) throw std::runtime_error("Streaming is only available for Wilson loops without gauge transformation");
+    if (options["-x"].find_first_not_of("0123456789") != std::string::npos || std::stoul(options["-x"]) == 0) throw std::runtime_error("Unknown batch size: " + options["-x"]);
+    if (options["-x"] != "1" && (options["-e"] != "wilson" || options["-w"] != "0")) throw std::runtime_error("Batching is only available for Wilson loops without streaming");
+
+    std::vector<std::string> inputs = expandInputs(options["-i"]);
+    param_Grid = getGeometry(options["-g"], inputs.size() > 0 ? inputs[0] : options["-i"]);
+    std::cout << "Lattice shape: " << param_Grid[0] << "x" << param_Grid[1] << "x" << param_Grid[2] << "x" << param_Grid[3] << "\n";
+    if (options["-c"] != "") openCheckpoint(options, inputs);
+    if (inputs.size() > 1) {
+        std::cout << "Running over " << inputs.size() << " configs\n";
+        runEnsemble(inputs, options);
+        return 0;
+    }
+
+    std::string input = (inputs.size() == 1) ? inputs[0] : options["-i"];
+    if (checkpoint != nullptr && checkpoint->isComplete(0)) {
+        std::cout << "Checkpoint records config " << input << " as already measured\n";
+        return 0;
+    }
+    if (options["-w"] != "0") {
+        StreamingLattice config(param_Grid, std::stoul(options["-w"]), param_Grid[3]/4, verbose, options["-u"], options["-f"]);
+        std::cout << "Streaming config: " << input << " through " << config.getWindow().getShape()[3] << " timeslices using " << config.getWindow().getBytes()/(1024.*1024.) << " MB in " << options["-f"] << " format\n";
+        if (smearing.method != "none") std::cout << "Smearing spatial links as they are read: " << smearing.describe() << "\n";
+        config.setSmearing(smearing);
+        config.readConfig(input);
+        if (options["-r"] == "binary") {
+            std::cout << "Running Wilson loop experiment and appending results to: " << options["-o"] << "\n";
+            ResultFile results(options["-o"], param_Grid, param_Grid[0]/2, param_Grid[3]/4);
+            runWilsonExperimentBinary(&config, results, getStem(input));
+        } else {
+            std::cout << "Running Wilson loop experiment and outputting results to: " << options["-o"] << "\n";
+            runWilsonExperimentMP(&config, options["-o"]);
+        }
+        if (checkpoint != nullptr) checkpoint->addConfig(0, ConfigRecord{getStem(input), options["-r"] == "binary" ? getFileSize(options["-o"]) : 0, {}, ""});
+        return 0;
+    }
 
-    std::cout << "Loading config: " << options["-i"] << "\n";
-	Lattice* config = new Lattice(param_Grid, options["-i"], verbose, debug);
-    std::cout << "Config loaded\n";
-    std::cout << "Running Wilson loop experiment and outputting results to: " << options["-o"] << "\n";
-    runWilsonExperimentMP(config, options["-o"]);
+    std::cout << "Loading config: " << input << "\n";
+	Lattice* config = new Lattice(param_Grid, input, verbose, debug, options["-u"], options["-f"]);
+    std::cout << "Config loaded, links use " << config->getLinks().getBytes()/(1024.*1024.) << " MB in " << options["-f"] << " format\n";
+    if (smearing.method != "none") {
+        std::cout << "Smearing spatial links: " << smearing.describe() << "\n";
+        config->smearLinks(smearing);
+    }
+    if (options["-t"] == "temporal") {
+        std::cout << "Transforming to temporal gauge\n";
+        config->fixTemporalGauge();
+    }
+    if (options["-e"] == "polyakov") {
+        std::cout << "Running Polyakov loop experiment and outputting results to: " << options["-o"] << "\n";
+        runPolyakovExperiment(config, options["-o"]);
+    } else if (options["-e"] == "paths") {
+        std::cout << "Running loop shape experiment and outputting results to: " << options["-o"] << "\n";
+        runPathExperiment(config, options["-o"], parseLoopShapes(options["-l"]));
+    } else if (options["-r"] == "binary") {
+        std::cout << "Running Wilson loop experiment and appending results to: " << options["-o"] << "\n";
+        ResultFile results(options["-o"], param_Grid, param_Grid[0]/2, param_Grid[3]/4);
+        runWilsonExperimentBinary(config, results, getStem(input));
+    } else {
+        std::cout << "Running Wilson loop experiment and outputting results to: " << options["-o"] << "\n";
+        runWilsonExperimentMP(config, options["-o"]);
+    }
+    if (checkpoint != nullptr) checkpoint->addConfig(0, ConfigRecord{getStem(input), options["-r"] == "binary" ? getFileSize(options["-o"]) : 0, {}, ""});
 }
\ No newline at end of file
@@ -8,8 +8,30 @@
 #include <array>
 #include <complex>
 #include <map>
+#include <sstream>
+#include <memory>
+#include <future>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+//POSIX
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+//OpenMP
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 //project
 #include "lattice.hh"
+#include "streaminglattice.hh"
+#include "smearing.hh"
+#include "batchengine.hh"
+#include "ensemblestats.hh"
+#include "resultfile.hh"
+#include "checkpoint.hh"
+#include "checksum.hh"
+#include "topology.hh"
 #include "misc.hh"
 
 #endif /* MAIN_HH_ */
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "mappedfile.hh"
+
+MappedFile::MappedFile(std::string name) : MappedFile(name, 0, SIZE_MAX) { }
+
+MappedFile::MappedFile(std::string name, size_t offset, size_t length) : _name(name), _fd(-1), _fileSize(0), _size(0), _map(nullptr), _mapSize(0), _data(nullptr) {
+    /*Open file and map the window of length bytes from offset, clipped to the end of the file, throwing if it cannot be read.
+    The map starts at the page boundary below offset*/
+    _fd = open(_name.c_str(), O_RDONLY);
+    if (_fd < 0) throw std::runtime_error("Could not open file: " + _name);
+
+    struct stat info;
+    if (fstat(_fd, &info) != 0) {
+        close(_fd);
+        throw std::runtime_error("Could not stat file: " + _name);
+    }
+    _fileSize = static_cast<size_t>(info.st_size);
+    if (offset >= _fileSize) return;
+    _size = std::min(length, _fileSize - offset);
+
+    size_t start = offset - offset%static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    _mapSize = _size + (offset - start);
+    void* ptr = mmap(nullptr, _mapSize, PROT_READ, MAP_PRIVATE, _fd, static_cast<off_t>(start));
+    if (ptr == MAP_FAILED) {
+        close(_fd);
+        throw std::runtime_error("Could not map file: " + _name);
+    }
+    madvise(ptr, _mapSize, MADV_WILLNEED);
+    _map = static_cast<char*>(ptr);
+    _data = _map + (offset - start);
+}
+
+MappedFile::~MappedFile() {
+    if (_map != nullptr) munmap(_map, _mapSize);
+    if (_fd >= 0) close(_fd);
+}
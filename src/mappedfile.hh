@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_HH_
+#define MAPPEDFILE_HH_
+
+//C++
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+//POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class MappedFile {
+	/*Read-only memory map of a whole file, or of a window into it, unmapped on destruction*/
+
+private:
+	std::string _name;
+	int _fd;
+	size_t _fileSize;
+	size_t _size;
+	char* _map;
+	size_t _mapSize;
+	const char* _data;
+
+public:
+	MappedFile(std::string);
+	MappedFile(std::string, size_t, size_t);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+	size_t fileSize() const { return _fileSize; }
+	size_t size() const { return _size; }
+	const char* data() const { return _data; }
+};
+
+#endif /* MAPPEDFILE_HH_ */
@@ -0,0 +1,99 @@
+#include "mpimain.hh"
+
+std::string verbose = "";
+std::string defaultInput = "./Data/SU3_24_24_24_48_6.2000_1000_PHB_4_OR_7_dp.bin";
+std::string defaultOutput = "Output/SU3_24_24_24_48_6.2000_1000_PHB_4_OR_7_dp.csv";
+
+void showHelp() {
+    /*Show help for input arguments*/
+    std::cout << "-i : Input file name, default " << defaultInput << "\n";
+    std::cout << "-o : Output file name, default " << defaultOutput << "\n";
+    std::cout << "-g : Lattice shape Nx,Ny,Nz,Nt, default read from the header of a native input, else from <input>.shape if present, else from the SU3_Nx_Ny_Nz_Nt_ pattern of the input name\n";
+    std::cout << "-v : Run in verbose point, default off\n";
+    std::cout << "-u : Link validation on load [check/trust/fix], default check. Fix reunitarises non-unitary links instead of aborting\n";
+    std::cout << "-f : In-memory link format [double/tworow/float/tworowfloat], default double\n";
+    std::cout << "-a : Thread affinity within each rank [none/compact/spread], default none\n";
+    std::cout << "-p : Per-phase timing summary of rank 0 at exit [off/print/<file>], default off. A file name writes the summary as CSV\n";
+}
+
+std::map<std::string, std::string> getOptions(int argc, char* argv[]) {
+    /*Interpret input arguments*/
+    std::map<std::string, std::string> options;
+    options.insert(std::make_pair("-i", defaultInput)); //Input file
+    options.insert(std::make_pair("-o", defaultOutput)); //Output name
+    options.insert(std::make_pair("-v", "")); //Verbose mode
+    options.insert(std::make_pair("-u", "check")); //Link validation
+    options.insert(std::make_pair("-f", "double")); //Link format
+    options.insert(std::make_pair("-g", "")); //Lattice shape
+    options.insert(std::make_pair("-p", "off")); //Timing summary
+    options.insert(std::make_pair("-a", "none")); //Thread affinity
+
+    for (int i = 1; i < argc; i = i+2) {
+        std::string option(argv[i]);
+        if (option == "-h" || option == "--help" || i+1 >= argc) { //Check if help was requested
+            options.clear();
+            return options;
+        }
+        options[option] = argv[i+1];
+    }
+    return options;
+}
+
+void runWilsonExperiment(DistributedLattice& config, std::array<size_t, 4> shape, std::string name) {
+    /*Compute statistics of Wilson loops for the same range of R and T values as the single-process program and write them from rank 0*/
+    size_t maxR = shape[0]/2;
+    size_t maxT = shape[3]/4;
+    std::vector<RunningStats> stats = config.calcWilsonLoopTable(maxR, maxT);
+    if (config.getRank() != 0) return;
+
+    timing::Timer timer(timing::Phase::output);
+    std::ofstream outFile;
+    outFile.precision(50);
+    outFile.open(name);
+    outFile << "R,T,Mean,Std,Count\n";
+    for (size_t R = 1; R <= maxR; R++) {
+        for (size_t T = 1; T <= maxT; T++) {
+            const RunningStats& entry = stats[R*(maxT+1) + T];
+            outFile << R << "," << T << "," << entry.mean << "," << entry.std() << "," << entry.count << "\n";
+            if (verbose != "") std::cout << "(R, T) = " << R << ", " << T << ", mean = " << entry.mean << "+-" << entry.std() << "\n";
+        }
+    }
+    outFile.close();
+}
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank, nRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+    std::map<std::string, std::string> options = getOptions(argc, argv); //Get parsed arguments
+    if (options.size() == 0) {
+        if (rank == 0) showHelp();
+        MPI_Finalize();
+        return 1;
+    }
+    verbose = options["-v"];
+
+    try {
+        timing::Summary summary(rank == 0 ? options["-p"] : "off");
+        std::vector<topology::Cpu> placement = topology::pinThreads(options["-a"]);
+        if (rank == 0) topology::report(std::cout, options["-a"], placement);
+        std::array<size_t, 4> shape = getGeometry(options["-g"], options["-i"]);
+        if (rank == 0) {
+            std::cout << "Lattice shape: " << shape[0] << "x" << shape[1] << "x" << shape[2] << "x" << shape[3] << "\n";
+            std::cout << "Loading config: " << options["-i"] << " across " << nRanks << " ranks\n";
+        }
+        DistributedLattice config(MPI_COMM_WORLD, shape, shape[3]/4, verbose, options["-u"], options["-f"]);
+        config.readConfig(options["-i"]);
+        if (rank == 0) std::cout << "Running Wilson loop experiment and outputting results to: " << options["-o"] << "\n";
+        runWilsonExperiment(config, shape, options["-o"]);
+    } catch (std::exception& e) { //Errors are detected collectively, so every rank stops here together
+        if (rank == 0) std::cout << "Error: " << e.what() << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    MPI_Finalize();
+    return 0;
+}
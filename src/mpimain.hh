@@ -0,0 +1,19 @@
+#ifndef MPIMAIN_HH_
+#define MPIMAIN_HH_
+//c++
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <map>
+#include <exception>
+#include <stdexcept>
+//MPI
+#include <mpi.h>
+//project
+#include "distributedlattice.hh"
+#include "geometry.hh"
+#include "topology.hh"
+
+#endif /* MPIMAIN_HH_ */
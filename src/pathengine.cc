@@ -0,0 +1,184 @@
+#include "pathengine.hh"
+
+Path parsePath(std::string text) {
+    /*Read path written as signed directions, e.g. +x+y-x-y*/
+    Path path;
+    const std::string directions = "xyzt";
+    for (size_t i = 0; i < text.size(); i += 2) {
+        if (i+1 >= text.size() || (text[i] != '+' && text[i] != '-') || directions.find(text[i+1]) == std::string::npos) {
+            throw std::runtime_error("Invalid path: " + text);
+        }
+        path.push_back({directions.find(text[i+1]), text[i] == '+'});
+    }
+    return path;
+}
+
+std::string formatPath(const Path& path) {
+    /*Path as signed directions*/
+    std::string text;
+    for (const Step& step : path) {
+        text += step.forward ? '+' : '-';
+        text += "xyzt"[step.dir];
+    }
+    return text;
+}
+
+Path makeSpatialLine(std::array<int, 3> displacement) {
+    /*Staircase of spatial steps from x to x + displacement, interleaving directions so that the line stays as close
+    as possible to the straight one*/
+    Path path;
+    std::array<int, 3> length = {std::abs(displacement[0]), std::abs(displacement[1]), std::abs(displacement[2])};
+    std::array<int, 3> taken = {0, 0, 0};
+    const int total = length[0] + length[1] + length[2];
+    for (int k = 1; k <= total; k++) {
+        size_t best = 3;
+        double lag = -1;
+        for (size_t d = 0; d < 3; d++) { //Direction furthest behind its share of the first k steps
+            if (taken[d] == length[d]) continue;
+            double behind = static_cast<double>(length[d])*k/total - taken[d];
+            if (behind > lag) {
+                lag = behind;
+                best = d;
+            }
+        }
+        taken[best]++;
+        path.push_back({best, displacement[best] > 0});
+    }
+    return path;
+}
+
+Path makeWilsonPath(std::array<int, 3> displacement, size_t T) {
+    /*Wilson loop from x along the spatial line to x+r, up T timeslices, back along the line and down to x*/
+    Path line = makeSpatialLine(displacement);
+    Path path = line;
+    for (size_t i = 0; i < T; i++) path.push_back({3, true});
+    for (auto step = line.rbegin(); step != line.rend(); step++) path.push_back({step->dir, !step->forward});
+    for (size_t i = 0; i < T; i++) path.push_back({3, false});
+    return path;
+}
+
+std::vector<std::array<int, 3>> getOrientations(std::array<int, 3> shape) {
+    /*Distinct spatial displacements related to shape by the cubic symmetries of the lattice, counting r and -r once
+    since their loops have complex conjugate traces*/
+    std::set<std::array<int, 3>> orientations;
+    std::array<int, 3> axes = {0, 1, 2};
+    do {
+        for (int signs = 0; signs < 8; signs++) {
+            std::array<int, 3> r;
+            for (size_t d = 0; d < 3; d++) r[d] = ((signs >> d) & 1) ? -shape[axes[d]] : shape[axes[d]];
+            for (size_t d = 0; d < 3; d++) { //Choose the sign with first non-zero component positive
+                if (r[d] == 0) continue;
+                if (r[d] < 0) {
+                    for (int& component : r) component = -component;
+                }
+                break;
+            }
+            orientations.insert(r);
+        }
+    } while (std::next_permutation(axes.begin(), axes.end()));
+    orientations.erase({0, 0, 0});
+    return std::vector<std::array<int, 3>>(orientations.rbegin(), orientations.rend());
+}
+
+PathEngine::PathEngine(const LinkField& links, const std::vector<Path>& paths) : _links(links), _nPaths(paths.size()), _maxDepth(0) {
+    /*Build trie of paths. Every path must be non-empty and return to its start*/
+    struct TrieNode {
+        Step step;
+        std::map<std::pair<size_t, bool>, size_t> children;
+        std::vector<size_t> ends;
+    };
+    std::vector<TrieNode> trie(1);
+    for (size_t p = 0; p < paths.size(); p++) {
+        std::array<int, 4> displacement = {0, 0, 0, 0};
+        size_t node = 0;
+        for (const Step& step : paths[p]) {
+            if (step.dir > 3) throw std::runtime_error("Invalid path direction");
+            displacement[step.dir] += step.forward ? 1 : -1;
+            auto key = std::make_pair(step.dir, step.forward);
+            auto child = trie[node].children.find(key);
+            if (child == trie[node].children.end()) {
+                trie.push_back({step, {}, {}});
+                child = trie[node].children.insert(std::make_pair(key, trie.size() - 1)).first;
+            }
+            node = child->second;
+        }
+        if (paths[p].empty() || displacement != std::array<int, 4>{0, 0, 0, 0}) {
+            throw std::runtime_error("Path " + formatPath(paths[p]) + " is not a closed loop");
+        }
+        trie[node].ends.push_back(p);
+    }
+
+    //Flatten to depth-first order, skipping the root
+    std::vector<std::pair<size_t, size_t>> stack; //(trie node, depth)
+    for (auto child = trie[0].children.rbegin(); child != trie[0].children.rend(); child++) stack.push_back(std::make_pair(child->second, 1));
+    while (!stack.empty()) {
+        size_t node = stack.back().first, depth = stack.back().second;
+        stack.pop_back();
+        _nodes.push_back({trie[node].step, depth, trie[node].children.empty(), trie[node].ends});
+        _maxDepth = std::max(_maxDepth, depth);
+        for (auto child = trie[node].children.rbegin(); child != trie[node].children.rend(); child++) stack.push_back(std::make_pair(child->second, depth+1));
+    }
+}
+
+void PathEngine::accumulateSite(size_t site, std::vector<std::complex<double>>& products, std::vector<size_t>& positions, RunningStats* stats) const {
+    /*Add the trace of every path starting at site to stats. products[d] holds the product along the current prefix of length d
+    and positions[d] the site it ends at*/
+    const size_t n = LinkField::linkSize;
+    std::complex<double> scratch[9];
+    positions[0] = site;
+    su3::setIdentity(products.data());
+
+    for (const Node& node : _nodes) {
+        const std::complex<double>* prefix = products.data() + (node.depth-1)*n;
+        size_t point = positions[node.depth-1];
+        if (!node.step.forward) point = _links.prev(point, node.step.dir);
+        const std::complex<double>* link = _links.fetch(point, node.step.dir, scratch);
+
+        if (node.leaf) { //Only closes paths, so take the trace of the final product directly
+            double trace = node.step.forward ? su3::reTraceMul(prefix, link) : su3::reTraceMulDag(prefix, link);
+            for (size_t p : node.ends) stats[p].add(trace/3.);
+            continue;
+        }
+
+        std::complex<double>* product = products.data() + node.depth*n;
+        if (node.step.forward) {
+            su3::mul(prefix, link, product);
+            positions[node.depth] = _links.next(point, node.step.dir);
+        } else {
+            su3::mulDagRight(prefix, link, product);
+            positions[node.depth] = point;
+        }
+        for (size_t p : node.ends) stats[p].add(su3::trace(product).real()/3.);
+    }
+}
+
+std::vector<RunningStats> PathEngine::calcStats() const {
+    /*Statistics of each path over all sites, in the order the paths were given. Work items are the z planes of each timeslice,
+    with statistics kept per item and merged in a fixed order so that results do not depend on the thread count*/
+    const std::array<size_t, 4> shape = _links.getShape();
+    const size_t planeSites = shape[0]*shape[1];
+    const size_t nPlanes = shape[2]*shape[3];
+    std::vector<RunningStats> planeStats(nPlanes*_nPaths);
+
+    auto setup = [this]() {
+        return std::make_pair(std::vector<std::complex<double>>((_maxDepth+1)*LinkField::linkSize), std::vector<size_t>(_maxDepth+1));
+    };
+    auto work = [&](std::pair<std::vector<std::complex<double>>, std::vector<size_t>>& buffers, size_t plane) {
+        for (size_t site = plane*planeSites; site < (plane+1)*planeSites; site++) { //Loop over sites in plane
+            accumulateSite(site, buffers.first, buffers.second, planeStats.data() + plane*_nPaths);
+        }
+    };
+    scheduleWork(std::vector<double>(nPlanes, 1.), setup, work);
+
+    std::vector<RunningStats> stats(_nPaths);
+    for (size_t plane = 0; plane < nPlanes; plane++) {
+        for (size_t p = 0; p < _nPaths; p++) stats[p].merge(planeStats[plane*_nPaths + p]);
+    }
+    return stats;
+}
+
+timing::Work PathEngine::getWork() const {
+    /*Matrix products, counting traces of products, and bytes of links read by calcStats: one of each per trie node and site*/
+    const double volume = _links.getVolume();
+    return {volume*_nodes.size(), volume*_nodes.size()*_links.getLinkBytes()};
+}
@@ -0,0 +1,65 @@
+#ifndef PATHENGINE_HH_
+#define PATHENGINE_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <array>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "statistics.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+
+struct Step {
+	/*One link of a path: forward along dir multiplies by U(x,dir), backward by U(x-dir,dir)^dagger*/
+	size_t dir;
+	bool forward;
+};
+
+typedef std::vector<Step> Path;
+
+Path parsePath(std::string);
+std::string formatPath(const Path&);
+Path makeSpatialLine(std::array<int, 3>);
+Path makeWilsonPath(std::array<int, 3>, size_t);
+std::vector<std::array<int, 3>> getOrientations(std::array<int, 3>);
+
+class PathEngine {
+	/*Mean and variance of Re tr[U_path(x)]/3 over all sites x for any set of closed paths of signed steps.
+	Paths are merged into a prefix trie, so the partial product along a shared prefix is formed once per site and
+	reused by every path that starts with it. For Wilson loops of one spatial shape the spatial line and the temporal
+	steps up to T are shared by all larger T, so each extra path costs roughly its own closing steps.
+	The last step of a path that no other path extends is folded into the trace, costing a trace rather than a product*/
+
+private:
+	struct Node {
+		Step step;
+		size_t depth;
+		bool leaf;
+		std::vector<size_t> ends; //Paths that finish at this node
+	};
+
+	const LinkField& _links;
+	size_t _nPaths;
+	size_t _maxDepth;
+	std::vector<Node> _nodes; //Depth-first order, so each node's parent is the last earlier node one level up
+
+	void accumulateSite(size_t, std::vector<std::complex<double>>&, std::vector<size_t>&, RunningStats*) const;
+
+public:
+	PathEngine(const LinkField&, const std::vector<Path>&);
+	size_t getNodes() const { return _nodes.size(); }
+	std::vector<RunningStats> calcStats() const;
+	timing::Work getWork() const;
+};
+
+#endif /* PATHENGINE_HH_ */
@@ -0,0 +1,64 @@
+#include "plaquetteengine.hh"
+
+PlaquetteEngine::PlaquetteEngine(const LinkField& links) : _links(links) { }
+
+template <class Geometry>
+void PlaquetteEngine::accumulateSite(const Geometry& geometry, size_t site, RunningStats& spatial, RunningStats& temporal) const {
+    /*Add the six plaquettes based at site*/
+    const std::complex<double>* links[4][4]; //links[a][b] is U_b(x+a), with links[b][b] holding U_b(x)
+    std::complex<double> scratch[4][4][9];
+    for (size_t b = 0; b < 4; b++) links[b][b] = _links.fetch(site, b, scratch[b][b]);
+    for (size_t a = 0; a < 4; a++) {
+        size_t neighbour = geometry.next(site, a);
+        for (size_t b = 0; b < 4; b++) {
+            if (b != a) links[a][b] = _links.fetch(neighbour, b, scratch[a][b]);
+        }
+    }
+
+    std::complex<double> upper[9], lower[9];
+    for (size_t mu = 0; mu < 3; mu++) {
+        for (size_t nu = mu+1; nu < 4; nu++) {
+            su3::mul(links[mu][mu], links[mu][nu], upper); //U_mu(x).U_nu(x+mu)
+            su3::mul(links[nu][nu], links[nu][mu], lower); //U_nu(x).U_mu(x+nu)
+            double plaquette = su3::reTraceMulDag(upper, lower)/3.;
+            if (nu == 3) temporal.add(plaquette);
+            else spatial.add(plaquette);
+        }
+    }
+}
+
+PlaquetteStats PlaquetteEngine::calcStats() const {
+    /*Statistics of spatial/spatial and spatial/temporal plaquettes over the whole lattice*/
+    return dispatchGeometry(_links, [this](const auto& geometry) { return calcStats(geometry); });
+}
+
+template <class Geometry>
+PlaquetteStats PlaquetteEngine::calcStats(const Geometry& geometry) const {
+    /*Plaquette statistics walking the lattice with the given geometry. Statistics are kept per plane and merged in order,
+    so results do not depend on the thread count or schedule*/
+    const size_t planeSites = _links.getShape()[0]*_links.getShape()[1];
+    const size_t nPlanes = _links.getShape()[2]*_links.getShape()[3];
+
+    std::vector<PlaquetteStats> planeStats(nPlanes);
+    auto setup = []() { return 0; };
+    auto work = [&](int&, size_t plane) {
+        PlaquetteStats& stats = planeStats[plane];
+        for (size_t site = plane*planeSites; site < (plane+1)*planeSites; site++) { //Loop over sites in plane
+            accumulateSite(geometry, site, stats.spatial, stats.temporal);
+        }
+    };
+    scheduleWork(std::vector<double>(nPlanes, 1.), setup, work);
+
+    PlaquetteStats stats;
+    for (const PlaquetteStats& plane : planeStats) {
+        stats.spatial.merge(plane.spatial);
+        stats.temporal.merge(plane.temporal);
+    }
+    return stats;
+}
+
+timing::Work PlaquetteEngine::getWork() const {
+    /*Matrix products, counting each trace as one, and bytes of links read by calcStats*/
+    const double volume = _links.getVolume();
+    return {18.*volume, 16.*volume*_links.getLinkBytes()};
+}
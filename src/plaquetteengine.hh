@@ -0,0 +1,49 @@
+#ifndef PLAQUETTEENGINE_HH_
+#define PLAQUETTEENGINE_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "geometry.hh"
+#include "statistics.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+
+struct PlaquetteStats {
+	/*Statistics of Re tr(P)/3 over plaquettes in the spatial/spatial planes (xy, xz, yz) and the spatial/temporal planes (xt, yt, zt)*/
+	RunningStats spatial;
+	RunningStats temporal;
+
+	RunningStats overall() const {
+		RunningStats all = spatial;
+		all.merge(temporal);
+		return all;
+	}
+};
+
+class PlaquetteEngine {
+	/*All six plaquettes at every site in one parallel pass. The 16 links a site's plaquettes need, its own four and
+	one in each other direction at each forward neighbour, are fetched once each, and every plaquette
+	Re tr[(U_mu(x).U_nu(x+mu)).(U_nu(x).U_mu(x+nu))^dagger]/3 costs two products and a trace.
+	Work items are the z planes of each timeslice, so a thread walks a plane whose links, and those of the planes
+	above it in z and t, stay in cache*/
+
+private:
+	const LinkField& _links;
+
+	template <class Geometry>
+	void accumulateSite(const Geometry&, size_t, RunningStats&, RunningStats&) const;
+	template <class Geometry>
+	PlaquetteStats calcStats(const Geometry&) const;
+
+public:
+	PlaquetteEngine(const LinkField&);
+	PlaquetteStats calcStats() const;
+	timing::Work getWork() const;
+};
+
+#endif /* PLAQUETTEENGINE_HH_ */
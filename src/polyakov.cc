@@ -0,0 +1,54 @@
+#include "polyakov.hh"
+
+std::vector<std::complex<double>> PolyakovEngine::calcLoops() {
+    /*Polyakov loop at every spatial site, indexed as x + Nx*(y + Ny*z)*/
+    const size_t n = LinkField::linkSize;
+    const size_t nT = _links.getShape()[3];
+    const size_t spatialVolume = _links.getSpatialVolume();
+    std::vector<std::complex<double>> loops(spatialVolume);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t s = 0; s < spatialVolume; s++) { //Loop over spatial sites
+        std::complex<double> product[9], scratch[9];
+        const std::complex<double>* link = _links.fetch(s, 3, scratch);
+        std::copy(link, link + n, product);
+        for (size_t t = 1; t < nT; t++) su3::mul(product, _links.fetch(t*spatialVolume + s, 3, scratch), product);
+        loops[s] = su3::trace(product)/3.;
+    }
+    return loops;
+}
+
+std::vector<std::complex<double>> PolyakovEngine::calcCorrelator(const std::vector<std::complex<double>>& loops) {
+    /*C(r) = sum_x P(x).P(x+r)^* / Vs for every separation r, indexed as for the loops*/
+    std::array<size_t, 4> shape = _links.getShape();
+    const std::array<size_t, 3> spatialShape = {shape[0], shape[1], shape[2]};
+    const double spatialVolume = _links.getSpatialVolume();
+
+    std::vector<std::complex<double>> power(loops);
+    fft::transform3d(power.data(), spatialShape, -1);
+    for (std::complex<double>& p : power) p = std::norm(p);
+    fft::transform3d(power.data(), spatialShape, 1); //sum_x P(x+r).P(x)^* times Vs
+    for (std::complex<double>& p : power) p = std::conj(p)/(spatialVolume*spatialVolume);
+    return power;
+}
+
+std::vector<PolyakovBin> PolyakovEngine::binCorrelator(const std::vector<std::complex<double>>& correlator) {
+    /*Mean real part of the correlator over separations of equal |r|^2, in increasing order of |r|*/
+    std::array<size_t, 4> shape = _links.getShape();
+    std::map<size_t, std::pair<size_t, double>> bins;
+    for (size_t s = 0; s < correlator.size(); s++) {
+        size_t r2 = 0, rest = s;
+        for (size_t d = 0; d < 3; d++) {
+            size_t r = rest%shape[d];
+            rest /= shape[d];
+            r = std::min(r, shape[d] - r); //Shortest periodic image
+            r2 += r*r;
+        }
+        bins[r2].first++;
+        bins[r2].second += correlator[s].real();
+    }
+
+    std::vector<PolyakovBin> binned;
+    for (const auto& bin : bins) binned.push_back({bin.first, bin.second.first, bin.second.second/bin.second.first});
+    return binned;
+}
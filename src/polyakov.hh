@@ -0,0 +1,38 @@
+#ifndef POLYAKOV_HH_
+#define POLYAKOV_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <array>
+#include <map>
+#include <algorithm>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "fft.hh"
+
+struct PolyakovBin {
+	/*Correlator averaged over all separations r with the same |r|^2, using the shortest periodic image of each component*/
+	size_t r2;
+	size_t count;
+	double correlator;
+};
+
+class PolyakovEngine {
+	/*Polyakov loops P(x) = tr[U_t(x,0).U_t(x,1)...U_t(x,Nt-1)]/3 at every spatial site and their correlator
+	C(r) = sum_x P(x).P(x+r)^* / Vs for all spatial separations r at once. The sum over x is a cyclic correlation,
+	so C(r) is the inverse Fourier transform of |P(k)|^2 / Vs^2, costing O(Vs log Vs) rather than O(Vs^2)*/
+
+private:
+	const LinkField& _links;
+
+public:
+	PolyakovEngine(const LinkField& links) : _links(links) { }
+	std::vector<std::complex<double>> calcLoops();
+	std::vector<std::complex<double>> calcCorrelator(const std::vector<std::complex<double>>&);
+	std::vector<PolyakovBin> binCorrelator(const std::vector<std::complex<double>>&);
+};
+
+#endif /* POLYAKOV_HH_ */
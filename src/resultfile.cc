@@ -0,0 +1,55 @@
+#include "resultfile.hh"
+
+static_assert(sizeof(ResultHeader) == 128, "Result file header must be 128 bytes");
+
+ResultFile::ResultFile(std::string name, std::array<size_t, 4> shape, size_t maxR, size_t maxT) : _name(name) {
+    /*Open result file for appending, writing the header if the file is new or empty, or checking that an existing
+    header describes the same lattice shape and (R,T) grid*/
+    memset(&_header, 0, sizeof(_header));
+    memcpy(_header.magic, "LQCDWL01", 8);
+    _header.version = 1;
+    _header.headerBytes = sizeof(ResultHeader);
+    strncpy(_header.fields, "mean,std,count", sizeof(_header.fields) - 1);
+    for (size_t d = 0; d < 4; d++) _header.shape[d] = shape[d];
+    _header.maxR = maxR;
+    _header.maxT = maxT;
+    _header.nameBytes = nameBytes;
+    _header.recordBytes = nameBytes + maxR*maxT*nFields*sizeof(double);
+
+    std::ifstream existing(_name, std::ios::binary);
+    ResultHeader previous;
+    bool append = existing.good() && existing.read(reinterpret_cast<char*>(&previous), sizeof(previous)).gcount() > 0;
+    if (append && (existing.gcount() != sizeof(previous) || memcmp(&previous, &_header, sizeof(previous)) != 0)) {
+        throw std::runtime_error("Existing result file " + _name + " has a different header");
+    }
+    existing.close();
+
+    _file.open(_name, std::ios::binary | std::ios::app);
+    if (!_file.good()) throw std::runtime_error("Could not open result file: " + _name);
+    if (!append) {
+        _file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+        _file.flush();
+    }
+}
+
+void ResultFile::append(std::string config, const std::vector<RunningStats>& stats) {
+    /*Append the record of one config from statistics indexed by R*(maxT+1) + T. Names longer than nameBytes-1 are truncated*/
+    const size_t maxR = _header.maxR, maxT = _header.maxT;
+    if (stats.size() != (maxR+1)*(maxT+1)) throw std::runtime_error("Wilson loop table does not match result file (R,T) grid");
+
+    std::vector<char> record(_header.recordBytes, 0);
+    strncpy(record.data(), config.c_str(), nameBytes - 1);
+    double* values = reinterpret_cast<double*>(record.data() + nameBytes);
+    for (size_t R = 1; R <= maxR; R++) {
+        for (size_t T = 1; T <= maxT; T++) {
+            const RunningStats& entry = stats[R*(maxT+1) + T];
+            double* field = values + ((R-1)*maxT + (T-1))*nFields;
+            field[0] = entry.mean;
+            field[1] = entry.std();
+            field[2] = static_cast<double>(entry.count);
+        }
+    }
+    _file.write(record.data(), record.size());
+    _file.flush();
+    if (!_file.good()) throw std::runtime_error("Could not write to result file: " + _name);
+}
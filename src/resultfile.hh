@@ -0,0 +1,48 @@
+#ifndef RESULTFILE_HH_
+#define RESULTFILE_HH_
+
+//C++
+#include <string>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <stdexcept>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+//Project
+#include "statistics.hh"
+
+struct ResultHeader {
+	/*Fixed 128-byte header of a binary result file. All integers are little-endian as written on x86*/
+	char magic[8]; //"LQCDWL01"
+	uint32_t version;
+	uint32_t headerBytes;
+	char fields[32]; //Comma-separated names of the doubles stored per (R,T)
+	uint64_t shape[4]; //Nx, Ny, Nz, Nt
+	uint64_t maxR, maxT; //Records hold R = 1..maxR, T = 1..maxT
+	uint64_t nameBytes; //Width of the zero-padded config name at the start of each record
+	uint64_t recordBytes;
+	char padding[16];
+};
+
+class ResultFile {
+	/*Appendable binary file of per-config Wilson loop statistics for a whole ensemble. After the header, every record is
+	a config name of nameBytes followed by (mean, std, count) as doubles for each (R,T) with T running fastest, so the
+	file can be read without parsing as a numpy memmap of fixed-size records. Each record is flushed as it is written,
+	so an interrupted run leaves only whole records, and a later run can append to the same file if the header matches*/
+
+private:
+	std::string _name;
+	ResultHeader _header;
+	std::ofstream _file;
+
+public:
+	static constexpr size_t nameBytes = 64;
+	static constexpr size_t nFields = 3;
+
+	ResultFile(std::string, std::array<size_t, 4>, size_t, size_t);
+	void append(std::string, const std::vector<RunningStats>&);
+};
+
+#endif /* RESULTFILE_HH_ */
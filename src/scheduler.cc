@@ -0,0 +1,64 @@
+#include "scheduler.hh"
+
+WorkQueue::WorkQueue(const std::vector<double>& costs, size_t nThreads) : _prefix(costs.size() + 1, 0.), _ranges(std::max<size_t>(nThreads, 1)) {
+    /*Split items into contiguous ranges of equal cost, one per thread*/
+    for (size_t i = 0; i < costs.size(); i++) _prefix[i+1] = _prefix[i] + costs[i];
+
+    size_t begin = 0;
+    for (size_t r = 0; r < _ranges.size(); r++) {
+        double target = _prefix.back()*(r+1)/_ranges.size();
+        size_t end = (r+1 == _ranges.size()) ? costs.size() : std::lower_bound(_prefix.begin() + begin, _prefix.end() - 1, target) - _prefix.begin();
+        _ranges[r].begin = begin;
+        _ranges[r].end = std::max(begin, end);
+        begin = _ranges[r].end;
+    }
+}
+
+bool WorkQueue::next(size_t thread, size_t& item) {
+    /*Next item for thread, from its own range or else stolen. Returns false once every item has been handed out*/
+    Range& own = _ranges[thread%_ranges.size()];
+    do {
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.begin < own.end) {
+            item = own.begin++;
+            return true;
+        }
+    } while (steal(thread%_ranges.size()));
+    return false;
+}
+
+bool WorkQueue::steal(size_t thread) {
+    /*Move the back half by cost of the range with the most cost left to the empty range of thread. Returns false if
+    no range has work left. The victim's lock is released before the thief's own is taken, so thieves cannot deadlock*/
+    while (true) {
+        size_t victim = _ranges.size();
+        double most = 0;
+        for (size_t r = 0; r < _ranges.size(); r++) { //Unlocked estimate of cost left, checked again under the lock
+            Range& range = _ranges[r];
+            size_t begin = range.begin, end = range.end;
+            if (r != thread && begin < end && _prefix[end] - _prefix[begin] >= most) {
+                most = _prefix[end] - _prefix[begin];
+                victim = r;
+            }
+        }
+        if (victim == _ranges.size()) return false;
+
+        size_t begin, end;
+        {
+            Range& range = _ranges[victim];
+            std::lock_guard<std::mutex> guard(range.lock);
+            if (range.begin >= range.end) continue; //Emptied in the meantime
+            end = range.end;
+            double half = (_prefix[range.begin] + _prefix[end])/2;
+            size_t split = std::lower_bound(_prefix.begin() + range.begin + 1, _prefix.begin() + end, half) - _prefix.begin();
+            begin = std::min(split, end - 1); //Take at least the last item
+            range.end = begin;
+        }
+
+        Range& own = _ranges[thread];
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef SCHEDULER_HH_
+#define SCHEDULER_HH_
+
+//C++
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdlib.h>
+//OpenMP
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+class WorkQueue {
+	/*Work-stealing distribution of indexed work items with estimated costs between threads.
+	Each thread starts with a contiguous range of items holding an equal share of the total cost and takes items from
+	the front of its own range. A thread that runs out steals the back half, by cost, of the range with the most cost
+	left, so that no thread idles while work remains and there is no barrier until every item is done.
+	Items are coarse, e.g. a plane of sites, so a lock per range costs little against the work it guards*/
+
+private:
+	struct alignas(64) Range {
+		std::mutex lock;
+		std::atomic<size_t> begin, end; //Changed only under lock, read without it to choose a victim
+	};
+
+	std::vector<double> _prefix; //Cost of items before each index
+	std::vector<Range> _ranges;
+
+	bool steal(size_t);
+
+public:
+	WorkQueue(const std::vector<double>&, size_t);
+	bool next(size_t, size_t&);
+};
+
+inline size_t getSchedulerThreads() {
+	/*Threads that the following parallel region may use*/
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+inline size_t getPartBegin(size_t nItems, size_t part, size_t nParts) {
+	/*First item of part when nItems are split into nParts contiguous parts of equal size. These are the ranges WorkQueue
+	first gives each thread for items of equal cost*/
+	return (nItems*part + nParts - 1)/nParts;
+}
+
+template <class Setup, class Work>
+void scheduleWork(const std::vector<double>& costs, Setup&& setup, Work&& work) {
+	/*Call work(context, item) once for every item, on whichever thread reaches it first, where context = setup() is
+	made once per thread for scratch space. Work for different items must write to different places, so results
+	can be combined in a fixed order afterwards whatever the schedule*/
+	WorkQueue queue(costs, getSchedulerThreads());
+
+	#pragma omp parallel
+	{
+#ifdef _OPENMP
+		size_t thread = omp_get_thread_num();
+#else
+		size_t thread = 0;
+#endif
+		auto context = setup();
+		size_t item;
+		while (queue.next(thread, item)) work(context, item);
+	}
+}
+
+#endif /* SCHEDULER_HH_ */
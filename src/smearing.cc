@@ -0,0 +1,196 @@
+#include "smearing.hh"
+
+namespace {
+    template <class Geometry, class Fetch>
+    void addStaples(const Geometry& geometry, size_t site, size_t mu, size_t nu, Fetch&& fetch, std::complex<double>* sum) {
+        /*Add the staples of link mu at site in direction nu, U_nu(x).U_mu(x+nu).U_nu(x+mu)^dagger and
+        U_nu(x-nu)^dagger.U_mu(x-nu).U_nu(x-nu+mu), to sum, where fetch(site, dir, scratch) gives each link*/
+        std::complex<double> scratch[3][9], product[9], staple[9];
+        const size_t down = geometry.prev(site, nu);
+        su3::mul(fetch(site, nu, scratch[0]), fetch(geometry.next(site, nu), mu, scratch[1]), product);
+        su3::mulDagRight(product, fetch(geometry.next(site, mu), nu, scratch[2]), staple);
+        for (size_t k = 0; k < 9; k++) sum[k] += staple[k];
+        su3::mulDagLeft(fetch(down, nu, scratch[0]), fetch(down, mu, scratch[1]), product);
+        su3::mul(product, fetch(geometry.next(down, mu), nu, scratch[2]), staple);
+        for (size_t k = 0; k < 9; k++) sum[k] += staple[k];
+    }
+
+    bool blend(const std::complex<double>* link, const std::complex<double>* staples, double alpha, double nStaples, std::complex<double>* out) {
+        /*SU(3) projection of (1-alpha).link + alpha/nStaples.staples into out. False if it cannot be projected*/
+        for (size_t k = 0; k < 9; k++) out[k] = (1. - alpha)*link[k] + (alpha/nStaples)*staples[k];
+        return su3::project(out);
+    }
+
+    size_t otherSlot(size_t mu, size_t nu) {
+        /*Which of the two decorated links of direction mu is the one not smeared towards nu*/
+        return (nu < mu) ? nu : nu - 1;
+    }
+}
+
+std::string SmearingParameters::describe() const {
+    /*Description for progress output*/
+    std::stringstream text;
+    if (method == "ape") text << iterations << " APE iterations with alpha = " << alpha1;
+    else if (method == "hyp") text << iterations << " HYP iterations with alpha1 = " << alpha1 << ", alpha2 = " << alpha2;
+    else text << "none";
+    return text.str();
+}
+
+SmearingParameters parseSmearing(std::string spec) {
+    /*Parse none, ape:<iterations>[:<alpha>] or hyp:<iterations>[:<alpha1>,<alpha2>]. Unless given, APE uses alpha = 0.5
+    and HYP uses alpha1 = 0.6, alpha2 = 0.3. The alpha1 = 0.75, alpha2 = 0.6 of four-dimensional HYP put twice the weight
+    on each staple of a decorated link here, which only has two, and repeated iterations then roughen rather than smooth*/
+    SmearingParameters parameters{"none", 0, 0., 0.};
+    if (spec == "none" || spec == "") return parameters;
+
+    std::vector<std::string> fields;
+    std::stringstream stream(spec);
+    std::string field;
+    while (std::getline(stream, field, ':')) fields.push_back(field);
+    if (fields.size() < 2 || fields.size() > 3 || (fields[0] != "ape" && fields[0] != "hyp")) throw std::runtime_error("Unknown smearing: " + spec);
+    parameters.method = fields[0];
+    parameters.alpha1 = (parameters.method == "ape") ? 0.5 : 0.6;
+    parameters.alpha2 = (parameters.method == "ape") ? 0. : 0.3;
+    try {
+        size_t used;
+        parameters.iterations = std::stoul(fields[1], &used);
+        if (used != fields[1].size()) throw std::runtime_error("Unknown smearing: " + spec);
+        if (fields.size() == 3) {
+            std::string weights = fields[2];
+            size_t comma = weights.find(',');
+            if ((comma == std::string::npos) != (parameters.method == "ape")) throw std::runtime_error("Unknown smearing: " + spec);
+            parameters.alpha1 = std::stod(weights.substr(0, comma));
+            if (comma != std::string::npos) parameters.alpha2 = std::stod(weights.substr(comma + 1));
+        }
+    } catch (std::logic_error& e) {
+        throw std::runtime_error("Unknown smearing: " + spec);
+    }
+    if (!(parameters.alpha1 >= 0. && parameters.alpha1 <= 1.) || !(parameters.alpha2 >= 0. && parameters.alpha2 <= 1.)) {
+        throw std::runtime_error("Smearing weights must lie between 0 and 1: " + spec);
+    }
+    return parameters;
+}
+
+SmearingEngine::SmearingEngine(LinkField& links, SmearingParameters parameters) : _links(links), _parameters(parameters) {
+    if (_parameters.method != "none" && _parameters.method != "ape" && _parameters.method != "hyp") throw std::runtime_error("Unknown smearing: " + _parameters.method);
+}
+
+void SmearingEngine::smear() {
+    /*Smear every timeslice*/
+    smear(0, _links.getShape()[3]);
+}
+
+void SmearingEngine::smear(size_t first, size_t nSlices) {
+    /*Smear nSlices timeslices from timeslice first, leaving the others untouched*/
+    if (_parameters.method == "none" || _parameters.iterations == 0 || nSlices == 0) return;
+    if (first + nSlices > _links.getShape()[3]) throw std::runtime_error("Smearing beyond the last timeslice");
+    _smeared.resize(3*nSlices*_links.getSpatialVolume()*LinkField::linkSize);
+    if (_parameters.method == "hyp") _decorated.resize(2*_smeared.size());
+
+    dispatchGeometry(_links, [&](const auto& geometry) {
+        for (size_t iteration = 0; iteration < _parameters.iterations; iteration++) {
+            if (_parameters.method == "ape") sweepAPE(geometry, first, nSlices);
+            else sweepHYP(geometry, first, nSlices);
+            copyBack(first, nSlices);
+        }
+    });
+}
+
+template <class Work>
+void SmearingEngine::forEachSite(size_t first, size_t nSlices, Work&& work) {
+    /*Call work(site) for every site of the timeslices, one (t,z) plane per work item. Throws if work fails anywhere*/
+    const size_t planeSites = _links.getShape()[0]*_links.getShape()[1];
+    const size_t firstPlane = first*_links.getShape()[2];
+    const size_t nPlanes = nSlices*_links.getShape()[2];
+    bool failed = false;
+    auto setup = []() { return 0; };
+    auto planeWork = [&](int&, size_t item) {
+        const size_t plane = firstPlane + item;
+        for (size_t site = plane*planeSites; site < (plane+1)*planeSites; site++) { //Loop over sites in plane
+            if (!work(site)) {
+                #pragma omp atomic write
+                failed = true;
+            }
+        }
+    };
+    scheduleWork(std::vector<double>(nPlanes, 1.), setup, planeWork);
+    if (failed) throw std::runtime_error("Smeared link could not be projected onto SU(3)");
+}
+
+template <class Geometry>
+void SmearingEngine::sweepAPE(const Geometry& geometry, size_t first, size_t nSlices) {
+    /*One APE iteration of the timeslices into _smeared*/
+    const size_t n = LinkField::linkSize;
+    const size_t firstSite = first*_links.getSpatialVolume();
+    auto fetch = [this](size_t site, size_t dir, std::complex<double>* scratch) { return _links.fetch(site, dir, scratch); };
+    forEachSite(first, nSlices, [&](size_t site) {
+        bool projected = true;
+        for (size_t mu = 0; mu < 3; mu++) { //Direction iteration
+            std::complex<double> staples[9] = {}, scratch[9];
+            for (size_t nu = 0; nu < 3; nu++) {
+                if (nu != mu) addStaples(geometry, site, mu, nu, fetch, staples);
+            }
+            projected &= blend(_links.fetch(site, mu, scratch), staples, _parameters.alpha1, 4., _smeared.data() + (3*(site - firstSite) + mu)*n);
+        }
+        return projected;
+    });
+}
+
+template <class Geometry>
+void SmearingEngine::sweepHYP(const Geometry& geometry, size_t first, size_t nSlices) {
+    /*One HYP iteration of the timeslices into _smeared. The decorated link of direction mu not smeared towards nu is
+    smeared with the two staples in the remaining spatial direction. The link of direction mu is then smeared with
+    staples whose sides in direction nu are not smeared towards mu and whose middle is not smeared towards nu*/
+    const size_t n = LinkField::linkSize;
+    const size_t firstSite = first*_links.getSpatialVolume();
+    auto fetch = [this](size_t site, size_t dir, std::complex<double>* scratch) { return _links.fetch(site, dir, scratch); };
+    forEachSite(first, nSlices, [&](size_t site) {
+        bool projected = true;
+        for (size_t mu = 0; mu < 3; mu++) { //Direction iteration
+            std::complex<double> scratch[9];
+            const std::complex<double>* link = _links.fetch(site, mu, scratch);
+            for (size_t nu = 0; nu < 3; nu++) {
+                if (nu == mu) continue;
+                std::complex<double> staples[9] = {};
+                addStaples(geometry, site, mu, 3 - mu - nu, fetch, staples);
+                projected &= blend(link, staples, _parameters.alpha2, 2., _decorated.data() + (2*(3*(site - firstSite) + mu) + otherSlot(mu, nu))*n);
+            }
+        }
+        return projected;
+    });
+
+    forEachSite(first, nSlices, [&](size_t site) {
+        bool projected = true;
+        for (size_t mu = 0; mu < 3; mu++) { //Direction iteration
+            std::complex<double> staples[9] = {}, scratch[9];
+            for (size_t nu = 0; nu < 3; nu++) {
+                if (nu == mu) continue;
+                auto decorated = [&](size_t point, size_t dir, std::complex<double>*) -> const std::complex<double>* {
+                    return _decorated.data() + (2*(3*(point - firstSite) + dir) + otherSlot(dir, (dir == mu) ? nu : mu))*n;
+                };
+                addStaples(geometry, site, mu, nu, decorated, staples);
+            }
+            projected &= blend(_links.fetch(site, mu, scratch), staples, _parameters.alpha1, 4., _smeared.data() + (3*(site - firstSite) + mu)*n);
+        }
+        return projected;
+    });
+}
+
+void SmearingEngine::copyBack(size_t first, size_t nSlices) {
+    /*Store the smeared spatial links of the timeslices in the link field*/
+    const size_t firstSite = first*_links.getSpatialVolume();
+    forEachSite(first, nSlices, [&](size_t site) {
+        for (size_t mu = 0; mu < 3; mu++) _links.store(site, mu, _smeared.data() + (3*(site - firstSite) + mu)*LinkField::linkSize);
+        return true;
+    });
+}
+
+timing::Work SmearingEngine::getWork(size_t nSlices) const {
+    /*Matrix products and bytes of links read by smear over nSlices timeslices. Projections are not counted*/
+    if (_parameters.method == "none") return {0., 0.};
+    const double sites = _parameters.iterations*nSlices*_links.getSpatialVolume();
+    const double linkBytes = _links.getLinkBytes();
+    const double decoratedBytes = LinkField::linkSize*sizeof(std::complex<double>);
+    if (_parameters.method == "ape") return {24.*sites, 3.*13.*linkBytes*sites};
+    return {48.*sites, 6.*7.*linkBytes*sites + 3.*(linkBytes + 12.*decoratedBytes)*sites};
+}
@@ -0,0 +1,63 @@
+#ifndef SMEARING_HH_
+#define SMEARING_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "geometry.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+
+struct SmearingParameters {
+	/*Smearing of the spatial links before measuring. Each iteration of APE replaces every spatial link by the SU(3)
+	projection of (1-alpha1).U + alpha1/4 times the sum of its four spatial staples. HYP does the same with staples
+	built from decorated links, each of which is first smeared with weight alpha2 in the one spatial direction
+	orthogonal to both the link and the staple, so that the smeared link only feels its own spatial hypercube.
+	Temporal links are never changed*/
+	std::string method; //none, ape or hyp
+	size_t iterations;
+	double alpha1; //Weight of the staples of each link
+	double alpha2; //HYP only: weight of the staples of the decorated links
+
+	std::string describe() const;
+};
+
+SmearingParameters parseSmearing(std::string);
+
+class SmearingEngine {
+	/*Smearing of the spatial links of a range of timeslices in place. Spatial staples never leave their timeslice, so
+	every timeslice is smeared independently and a window of timeslices gives the same links as the whole lattice.
+	Each iteration is a parallel sweep over the (t,z) planes that reads only the link field and writes the smeared links
+	to a separate buffer, followed by a parallel copy back, so the result does not depend on the thread count or
+	schedule. For HYP, the decorated links of the whole range are built by a sweep of their own before the sweep
+	that uses them*/
+
+private:
+	LinkField& _links;
+	SmearingParameters _parameters;
+	std::vector<std::complex<double>> _smeared; //New spatial links, 3 per site
+	std::vector<std::complex<double>> _decorated; //HYP: 2 per spatial link, one for each other spatial direction
+
+	template <class Geometry>
+	void sweepAPE(const Geometry&, size_t, size_t);
+	template <class Geometry>
+	void sweepHYP(const Geometry&, size_t, size_t);
+	template <class Work>
+	void forEachSite(size_t, size_t, Work&&);
+	void copyBack(size_t, size_t);
+
+public:
+	SmearingEngine(LinkField&, SmearingParameters);
+	void smear();
+	void smear(size_t, size_t);
+	timing::Work getWork(size_t) const;
+};
+
+#endif /* SMEARING_HH_ */
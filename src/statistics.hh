@@ -0,0 +1,42 @@
+#ifndef STATISTICS_HH_
+#define STATISTICS_HH_
+
+//C++
+#include <cmath>
+#include <stdlib.h>
+
+struct RunningStats {
+	/*Single-pass mean and variance by Welford's update, with partial results from different threads, timeslices or
+	processes combined by Chan et al.'s pairwise formula. Merging partials in a fixed order gives results that do not
+	depend on how the samples were shared out*/
+	size_t count;
+	double mean;
+	double m2; //Sum of squared deviations from the mean
+
+	RunningStats() : count(0), mean(0.), m2(0.) { }
+
+	void add(double x) {
+		count++;
+		double delta = x - mean;
+		mean += delta/count;
+		m2 += delta*(x - mean);
+	}
+
+	void merge(const RunningStats& other) {
+		if (other.count == 0) return;
+		if (count == 0) {
+			*this = other;
+			return;
+		}
+		double n = static_cast<double>(count + other.count);
+		double delta = other.mean - mean;
+		mean += delta*(other.count/n);
+		m2 += other.m2 + delta*delta*(count*(other.count/n));
+		count += other.count;
+	}
+
+	double variance() const { return (count > 0) ? m2/count : 0.; } //Population variance, as for the sample std
+	double std() const { return std::sqrt(variance()); }
+};
+
+#endif /* STATISTICS_HH_ */
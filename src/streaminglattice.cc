@@ -0,0 +1,151 @@
+#include "streaminglattice.hh"
+
+StreamingLattice::StreamingLattice(std::array<size_t, 4> shape, size_t blockSlices, size_t halo,
+                                   std::string verbose, std::string validation, std::string format) : _smearing{"none", 0, 0., 0.} {
+    /*Allocate a window of blockSlices base timeslices followed by halo timeslices in the given link format*/
+    _shape = shape;
+    _blockSlices = std::min(blockSlices, _shape[3]);
+    _halo = halo;
+    if (_blockSlices == 0) throw std::runtime_error("Streaming window needs at least one base timeslice");
+    _verbose = tracing::parsePoints(verbose);
+    if (validation != "check" && validation != "trust" && validation != "fix") throw std::runtime_error("Unknown link validation: " + validation);
+    _validation = validation;
+    _window.allocate({_shape[0], _shape[1], _shape[2], _blockSlices + _halo}, parseLinkFormat(format));
+}
+
+void StreamingLattice::readConfig(std::string configName) {
+    /*Open configuration for streaming, checking that its size matches the lattice shape. Links are only read and
+    validated, and the timeslices of a native file checked against their CRC, as the window reaches them*/
+    if (verbose(tracing::load)) std::cout << "Opening configuration for streaming: " << configName << "\n";
+    _file.reset();
+    _file.reset(new ConfigFile(configName, _shape));
+    _configName = configName;
+}
+
+void StreamingLattice::readSlices(size_t first, size_t nSlices, std::vector<std::complex<double>>& buffer) const {
+    /*Read nSlices timeslices of the file from timeslice first, wrapping round at Nt, into buffer in file order*/
+    const size_t sliceElements = 4*LinkField::linkSize*_window.getSpatialVolume();
+    buffer.resize(nSlices*sliceElements);
+    timing::Timer timer(timing::Phase::read);
+    timer.count({0, static_cast<double>(nSlices*_file->getSliceBytes())});
+
+    for (size_t s = 0; s < nSlices; ) {
+        size_t t = (first + s)%_shape[3];
+        size_t run = std::min(nSlices - s, _shape[3] - t); //Timeslices are contiguous in the file up to the last one
+        _file->readSlices(t, run, buffer.data() + s*sliceElements);
+        s += run;
+    }
+}
+
+void StreamingLattice::storeSlices(const std::vector<std::complex<double>>& buffer, size_t first, size_t slot, size_t nSlices, FixStats& fixes) {
+    /*Store and validate nSlices timeslices read from timeslice first into the window from slot onwards. Here first is
+    not wrapped, so that timeslices at or beyond Nt, which are read for a second time, are not added to fixes again*/
+    const size_t spatialVolume = _window.getSpatialVolume();
+    const size_t sliceElements = 4*LinkField::linkSize*spatialVolume;
+    const bool validate = _validation != "trust";
+    timing::Timer timer(timing::Phase::load);
+    timer.count({0, static_cast<double>(buffer.size()*sizeof(std::complex<double>) + nSlices*_window.getSliceBytes())});
+
+    const size_t parts[2] = {(first < _shape[3]) ? std::min(nSlices, _shape[3] - first) : 0, 0};
+    FixStats repeated;
+    for (size_t p = 0, offset = 0; p < 2; p++) {
+        size_t count = (p == 0) ? parts[0] : nSlices - parts[0];
+        if (count == 0) continue;
+        FixStats* target = (_validation == "fix") ? ((p == 0) ? &fixes : &repeated) : nullptr;
+        size_t invalid = _window.load(buffer.data() + offset*sliceElements, slot + offset, count, validate, target, getLinkTolerance(_file->getFormat()));
+        if (invalid < 4*spatialVolume*count) {
+            size_t site = invalid/4, d = invalid%4;
+            const std::complex<double>* link = buffer.data() + (offset*sliceElements + invalid*LinkField::linkSize);
+            std::array<size_t, 4> point = _window.coordinates(site%spatialVolume);
+            point[3] = (first + offset + site/spatialVolume)%_shape[3];
+            std::cout << "Matrix at (" << point[0] << "," << point[1] << "," << point[2] << "," << point[3] << ") in " << "xyzt"[d] << " direction is not unitary\n";
+            std::cout << "Determinant is: " << su3::det(link) << "\n";
+            std::cout << "Largest element of U.U^dagger - 1 is: " << su3::unitarityDeviation(link) << std::endl;
+            throw std::runtime_error("Non-unitary matrix");
+        }
+        offset += count;
+    }
+}
+
+void StreamingLattice::smearSlices(SmearingEngine& engine, size_t slot, size_t nSlices) {
+    /*Smear the nSlices timeslices of the window from slot onwards*/
+    if (_smearing.method == "none") return;
+    timing::Timer timer(timing::Phase::smear);
+    engine.smear(slot, nSlices);
+    timer.count(engine.getWork(nSlices));
+}
+
+xt::xtensor<RunningStats, 2> StreamingLattice::calcWilsonLoopTable(size_t maxR, size_t maxT, Checkpoint* checkpoint) {
+    /*Calculate mean, variance and count of Wilson loops for all R <= maxR and T <= maxT in a single pass through the file, indexed as (R,T).
+    With a checkpoint, every block is recorded as it finishes, and blocks recorded by an earlier run are not read or measured again*/
+    if (_file == nullptr) throw std::runtime_error("No configuration opened for streaming");
+    if (maxT > _halo) throw std::runtime_error("Wilson loop extent T = " + std::to_string(maxT) + " exceeds halo depth " + std::to_string(_halo));
+    if (verbose(tracing::calcWilsonLoopTable)) std::cout << "\nStreaming all Wilson loops up to (R,T) = (" << maxR << "," << maxT << ") through " << _blockSlices + _halo << " timeslices\n";
+    const size_t nT = _shape[3];
+    WilsonEngine engine(_window, maxR, maxT);
+    SmearingEngine smearing(_window, _smearing);
+    const size_t nEntries = engine.getEntries();
+    std::vector<RunningStats> sliceStats(nT*nEntries);
+    std::vector<bool> done(nT, false);
+    if (checkpoint != nullptr) {
+        for (const SliceBlock& block : checkpoint->getBlocks()) {
+            if (block.stats.size()%nEntries != 0 || block.first + block.stats.size()/nEntries > nT) throw std::runtime_error("Checkpoint " + checkpoint->getName() + " does not match the Wilson loop table");
+            std::copy(block.stats.begin(), block.stats.end(), sliceStats.begin() + block.first*nEntries);
+            std::fill(done.begin() + block.first, done.begin() + block.first + block.stats.size()/nEntries, true);
+        }
+    }
+
+    std::vector<size_t> blocks; //First timeslice of each block still to measure
+    for (size_t first = 0; first < nT; first += _blockSlices) {
+        size_t nSlices = std::min(_blockSlices, nT - first);
+        if (!std::all_of(done.begin() + first, done.begin() + first + nSlices, [](bool slice) { return slice; })) blocks.push_back(first);
+    }
+
+    FixStats fixes;
+    std::vector<std::complex<double>> current, next;
+    std::future<void> reading;
+    for (size_t b = 0; b < blocks.size(); b++) { //Loop over blocks of t
+        size_t first = blocks[b];
+        size_t nSlices = std::min(_blockSlices, nT - first);
+        if (b > 0 && blocks[b-1] + _blockSlices == first) { //Advance window from the previous block
+            reading.get();
+            memmove(_window.getSlice(0), _window.getSlice(_blockSlices), _halo*_window.getSliceBytes());
+            storeSlices(next, first + _halo, _halo, nSlices, fixes);
+            smearSlices(smearing, _halo, nSlices);
+        } else { //Fill window
+            readSlices(first, nSlices + _halo, current);
+            storeSlices(current, first, 0, nSlices + _halo, fixes);
+            smearSlices(smearing, 0, nSlices + _halo);
+        }
+        if (b+1 < blocks.size() && blocks[b+1] == first + _blockSlices) {
+            size_t nextFirst = blocks[b+1];
+            size_t nextSlices = std::min(_blockSlices, nT - nextFirst);
+            reading = std::async(std::launch::async, [this, &next, nextFirst, nextSlices]() {
+                topology::releaseThread();
+                readSlices(nextFirst + _halo, nextSlices, next);
+            });
+        }
+
+        timing::Timer timer(timing::Phase::wilsonTable);
+        std::vector<RunningStats> block = engine.calcSliceStats(0, nSlices);
+        timer.count(engine.getWork(nSlices));
+        timer.stop();
+        std::copy(block.begin(), block.end(), sliceStats.begin() + first*nEntries);
+        if (checkpoint != nullptr) checkpoint->addBlock(first, block);
+    }
+
+    if (fixes.count > 0) {
+        std::cout << "Reunitarised " << fixes.count << " of " << 4*nT*_window.getSpatialVolume() << " links in " << _configName << ": largest deviation from SU(3) "
+                  << fixes.maxDeviation << ", largest element change " << fixes.maxChange << ", mean " << fixes.meanChange() << "\n";
+    }
+
+    std::vector<RunningStats> stats = engine.combineSliceStats(sliceStats);
+    xt::xtensor<RunningStats, 2> table = xt::xtensor<RunningStats, 2>(std::array<size_t, 2>{maxR+1, maxT+1});
+    for (size_t R = 0; R <= maxR; R++) {
+        for (size_t T = 0; T <= maxT; T++) {
+            table(R, T) = stats[engine.index(R, T)];
+            if (verbose(tracing::calcWilsonLoopTable)) std::cout << "(R,T) = (" << R << "," << T << "): " << table(R, T).mean << "+-" << table(R, T).std() << "\n";
+        }
+    }
+    return table;
+}
@@ -0,0 +1,60 @@
+#ifndef STREAMINGLATTICE_HH_
+#define STREAMINGLATTICE_HH_
+
+//C++
+#include <string>
+#include <iostream>
+#include <vector>
+#include <array>
+#include <complex>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string.h>
+//Project
+#include "xtensor/xtensor.hpp"
+#include "linkfield.hh"
+#include "su3.hh"
+#include "wilsonengine.hh"
+#include "checkpoint.hh"
+#include "configfile.hh"
+#include "smearing.hh"
+#include "instrument.hh"
+#include "topology.hh"
+
+class StreamingLattice {
+	/*A configuration measured straight from its file through a sliding window of timeslices, for lattices larger than memory.
+	The window holds a block of base timeslices followed by a halo of the next timeslices, the same layout as one rank of
+	DistributedLattice. Wilson loops based in the block are measured, then the window advances by a block: the halo moves
+	to its start and the timeslices after it are read from the file, wrapping round to the first timeslices at the periodic
+	boundary. The next timeslices are read on a background thread while the current block is measured. Per-timeslice
+	statistics are merged in the same order as for a whole lattice, so the results are identical to Lattice. Spatial
+	smearing stays within each timeslice, so timeslices are smeared as they enter the window*/
+
+private:
+	std::array<size_t, 4> _shape;
+	size_t _blockSlices, _halo;
+	LinkField _window;
+	uint32_t _verbose;
+	std::string _validation;
+	std::string _configName;
+	std::unique_ptr<ConfigFile> _file;
+	SmearingParameters _smearing;
+
+	void readSlices(size_t, size_t, std::vector<std::complex<double>>&) const;
+	void storeSlices(const std::vector<std::complex<double>>&, size_t, size_t, size_t, FixStats&);
+	void smearSlices(SmearingEngine&, size_t, size_t);
+	bool verbose(tracing::Point point) const { return tracing::enabled(_verbose, point); }
+
+public:
+	StreamingLattice(std::array<size_t, 4>, size_t, size_t, std::string, std::string, std::string);
+	StreamingLattice(const StreamingLattice&) = delete;
+	StreamingLattice& operator=(const StreamingLattice&) = delete;
+	std::array<size_t, 4> getShape() const { return _shape; }
+	const LinkField& getWindow() const { return _window; }
+	void readConfig(std::string);
+	void setSmearing(const SmearingParameters& smearing) { _smearing = smearing; }
+	xt::xtensor<RunningStats, 2> calcWilsonLoopTable(size_t, size_t, Checkpoint* checkpoint=nullptr);
+};
+
+#endif /* STREAMINGLATTICE_HH_ */
@@ -0,0 +1,400 @@
+#include "su3.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SU3_X86 1
+#include <immintrin.h>
+#endif
+
+#define SU3_INLINE static inline __attribute__((always_inline))
+
+namespace su3 {
+
+//Portable implementations, operating on interleaved (re, im) doubles to avoid the NaN handling of complex multiply
+SU3_INLINE void mulScalar(const double* u, const double* v, double* out) {
+    double r[18];
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            double re = 0, im = 0;
+            for (size_t k = 0; k < 3; k++) {
+                double ur = u[2*(3*i+k)], ui = u[2*(3*i+k)+1];
+                double vr = v[2*(3*k+j)], vi = v[2*(3*k+j)+1];
+                re += ur*vr - ui*vi;
+                im += ur*vi + ui*vr;
+            }
+            r[2*(3*i+j)] = re;
+            r[2*(3*i+j)+1] = im;
+        }
+    }
+    for (size_t i = 0; i < 18; i++) out[i] = r[i];
+}
+
+SU3_INLINE void mulDagLeftScalar(const double* u, const double* v, double* out) {
+    double r[18];
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            double re = 0, im = 0;
+            for (size_t k = 0; k < 3; k++) {
+                double ur = u[2*(3*k+i)], ui = -u[2*(3*k+i)+1];
+                double vr = v[2*(3*k+j)], vi = v[2*(3*k+j)+1];
+                re += ur*vr - ui*vi;
+                im += ur*vi + ui*vr;
+            }
+            r[2*(3*i+j)] = re;
+            r[2*(3*i+j)+1] = im;
+        }
+    }
+    for (size_t i = 0; i < 18; i++) out[i] = r[i];
+}
+
+SU3_INLINE void mulDagRightScalar(const double* u, const double* v, double* out) {
+    double r[18];
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            double re = 0, im = 0;
+            for (size_t k = 0; k < 3; k++) {
+                double ur = u[2*(3*i+k)], ui = u[2*(3*i+k)+1];
+                double vr = v[2*(3*j+k)], vi = -v[2*(3*j+k)+1];
+                re += ur*vr - ui*vi;
+                im += ur*vi + ui*vr;
+            }
+            r[2*(3*i+j)] = re;
+            r[2*(3*i+j)+1] = im;
+        }
+    }
+    for (size_t i = 0; i < 18; i++) out[i] = r[i];
+}
+
+SU3_INLINE double reTraceMulScalar(const double* u, const double* v) {
+    double re = 0;
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t k = 0; k < 3; k++) {
+            re += u[2*(3*i+k)]*v[2*(3*k+i)] - u[2*(3*i+k)+1]*v[2*(3*k+i)+1];
+        }
+    }
+    return re;
+}
+
+SU3_INLINE double reTraceMulDagScalar(const double* u, const double* v) {
+    double re = 0;
+    for (size_t i = 0; i < 18; i++) re += u[i]*v[i];
+    return re;
+}
+
+SU3_INLINE cplx traceMulDagScalar(const double* u, const double* v) {
+    double re = 0, im = 0;
+    for (size_t i = 0; i < 9; i++) {
+        re += u[2*i]*v[2*i] + u[2*i+1]*v[2*i+1];
+        im += u[2*i+1]*v[2*i] - u[2*i]*v[2*i+1];
+    }
+    return cplx(re, im);
+}
+
+SU3_INLINE void mulBatchScalar(const double* u, const double* v, double* out, size_t lanes, size_t first) {
+    //Lanes from first onwards, one at a time
+    for (size_t l = first; l < lanes; l++) {
+        double r[18];
+        for (size_t i = 0; i < 3; i++) {
+            for (size_t j = 0; j < 3; j++) {
+                double re = 0, im = 0;
+                for (size_t k = 0; k < 3; k++) {
+                    double ur = u[2*(3*i+k)*lanes + l], ui = u[(2*(3*i+k)+1)*lanes + l];
+                    double vr = v[2*(3*k+j)*lanes + l], vi = v[(2*(3*k+j)+1)*lanes + l];
+                    re += ur*vr - ui*vi;
+                    im += ur*vi + ui*vr;
+                }
+                r[2*(3*i+j)] = re;
+                r[2*(3*i+j)+1] = im;
+            }
+        }
+        for (size_t c = 0; c < 18; c++) out[c*lanes + l] = r[c];
+    }
+}
+
+SU3_INLINE void reTraceMulDagBatchScalar(const double* u, const double* v, double* out, size_t lanes, size_t first) {
+    for (size_t l = first; l < lanes; l++) {
+        double re = 0;
+        for (size_t c = 0; c < 18; c++) re += u[c*lanes + l]*v[c*lanes + l];
+        out[l] = re;
+    }
+}
+
+SU3_INLINE void dagger(const double* v, double* out) {
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            out[2*(3*i+j)] = v[2*(3*j+i)];
+            out[2*(3*i+j)+1] = -v[2*(3*j+i)+1];
+        }
+    }
+}
+
+#define AS_DOUBLE(p) reinterpret_cast<const double*>(p)
+#define AS_DOUBLE_OUT(p) reinterpret_cast<double*>(p)
+
+static void mulPortable(const cplx* u, const cplx* v, cplx* out) { mulScalar(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out)); }
+static void mulDagLeftPortable(const cplx* u, const cplx* v, cplx* out) { mulDagLeftScalar(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out)); }
+static void mulDagRightPortable(const cplx* u, const cplx* v, cplx* out) { mulDagRightScalar(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out)); }
+static double reTraceMulPortable(const cplx* u, const cplx* v) { return reTraceMulScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+static double reTraceMulDagPortable(const cplx* u, const cplx* v) { return reTraceMulDagScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+static cplx traceMulDagPortable(const cplx* u, const cplx* v) { return traceMulDagScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+static void mulBatchPortable(const double* u, const double* v, double* out, size_t lanes) { mulBatchScalar(u, v, out, lanes, 0); }
+static void reTraceMulDagBatchPortable(const double* u, const double* v, double* out, size_t lanes) { reTraceMulDagBatchScalar(u, v, out, lanes, 0); }
+
+static const KernelTable portableKernels = {"scalar", mulPortable, mulDagLeftPortable, mulDagRightPortable,
+                                            reTraceMulPortable, reTraceMulDagPortable, traceMulDagPortable,
+                                            mulBatchPortable, reTraceMulDagBatchPortable};
+
+#ifdef SU3_X86
+//AVX2: each row of three complex numbers is held as one 256-bit (elements 0,1) and one 128-bit (element 2) register.
+//A complex scalar times a row is accumulated as re*row and im*swap(row), combined with a single addsub at the end.
+#define SU3_AVX2 __attribute__((target("avx2,fma")))
+
+SU3_AVX2 static void mulAvx2Core(const double* u, const double* v, double* out, bool conjLeft) {
+    __m256d v01[3], vs01[3];
+    __m128d v2[3], vs2[3];
+    for (size_t k = 0; k < 3; k++) {
+        v01[k] = _mm256_loadu_pd(v + 6*k);
+        v2[k] = _mm_loadu_pd(v + 6*k + 4);
+        vs01[k] = _mm256_permute_pd(v01[k], 0x5);
+        vs2[k] = _mm_permute_pd(v2[k], 0x1);
+    }
+
+    __m256d r01[3];
+    __m128d r2[3];
+    for (size_t i = 0; i < 3; i++) {
+        __m256d re01 = _mm256_setzero_pd(), im01 = _mm256_setzero_pd();
+        __m128d re2 = _mm_setzero_pd(), im2 = _mm_setzero_pd();
+        for (size_t k = 0; k < 3; k++) {
+            size_t e = conjLeft ? 2*(3*k+i) : 2*(3*i+k);
+            double ar = u[e], ai = conjLeft ? -u[e+1] : u[e+1];
+            re01 = _mm256_fmadd_pd(_mm256_set1_pd(ar), v01[k], re01);
+            im01 = _mm256_fmadd_pd(_mm256_set1_pd(ai), vs01[k], im01);
+            re2 = _mm_fmadd_pd(_mm_set1_pd(ar), v2[k], re2);
+            im2 = _mm_fmadd_pd(_mm_set1_pd(ai), vs2[k], im2);
+        }
+        r01[i] = _mm256_addsub_pd(re01, im01);
+        r2[i] = _mm_addsub_pd(re2, im2);
+    }
+
+    for (size_t i = 0; i < 3; i++) {
+        _mm256_storeu_pd(out + 6*i, r01[i]);
+        _mm_storeu_pd(out + 6*i + 4, r2[i]);
+    }
+}
+
+SU3_AVX2 static double reTraceMulDagAvx2Core(const double* u, const double* v) {
+    __m256d acc = _mm256_mul_pd(_mm256_loadu_pd(u), _mm256_loadu_pd(v));
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(u + 4), _mm256_loadu_pd(v + 4), acc);
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(u + 8), _mm256_loadu_pd(v + 8), acc);
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(u + 12), _mm256_loadu_pd(v + 12), acc);
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_fmadd_pd(_mm_loadu_pd(u + 16), _mm_loadu_pd(v + 16), sum);
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+SU3_AVX2 static void mulAvx2(const cplx* u, const cplx* v, cplx* out) { mulAvx2Core(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out), false); }
+SU3_AVX2 static void mulDagLeftAvx2(const cplx* u, const cplx* v, cplx* out) { mulAvx2Core(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out), true); }
+SU3_AVX2 static void mulDagRightAvx2(const cplx* u, const cplx* v, cplx* out) {
+    double vdag[18];
+    dagger(AS_DOUBLE(v), vdag);
+    mulAvx2Core(AS_DOUBLE(u), vdag, AS_DOUBLE_OUT(out), false);
+}
+SU3_AVX2 static double reTraceMulAvx2(const cplx* u, const cplx* v) { return reTraceMulScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+SU3_AVX2 static double reTraceMulDagAvx2(const cplx* u, const cplx* v) { return reTraceMulDagAvx2Core(AS_DOUBLE(u), AS_DOUBLE(v)); }
+SU3_AVX2 static cplx traceMulDagAvx2(const cplx* u, const cplx* v) { return traceMulDagScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+
+//Batches: one 256-bit register holds an element of four lanes, so every operation is full width. Lanes beyond the
+//last multiple of four are done one at a time
+SU3_AVX2 static void mulBatchAvx2(const double* u, const double* v, double* out, size_t lanes) {
+    size_t l = 0;
+    for (; l + 4 <= lanes; l += 4) {
+        __m256d r[18];
+        for (size_t i = 0; i < 3; i++) {
+            for (size_t j = 0; j < 3; j++) {
+                __m256d re = _mm256_setzero_pd(), im = _mm256_setzero_pd();
+                for (size_t k = 0; k < 3; k++) {
+                    __m256d ur = _mm256_loadu_pd(u + 2*(3*i+k)*lanes + l), ui = _mm256_loadu_pd(u + (2*(3*i+k)+1)*lanes + l);
+                    __m256d vr = _mm256_loadu_pd(v + 2*(3*k+j)*lanes + l), vi = _mm256_loadu_pd(v + (2*(3*k+j)+1)*lanes + l);
+                    re = _mm256_fnmadd_pd(ui, vi, _mm256_fmadd_pd(ur, vr, re));
+                    im = _mm256_fmadd_pd(ui, vr, _mm256_fmadd_pd(ur, vi, im));
+                }
+                r[2*(3*i+j)] = re;
+                r[2*(3*i+j)+1] = im;
+            }
+        }
+        for (size_t c = 0; c < 18; c++) _mm256_storeu_pd(out + c*lanes + l, r[c]);
+    }
+    mulBatchScalar(u, v, out, lanes, l);
+}
+
+SU3_AVX2 static void reTraceMulDagBatchAvx2(const double* u, const double* v, double* out, size_t lanes) {
+    size_t l = 0;
+    for (; l + 4 <= lanes; l += 4) {
+        __m256d acc = _mm256_setzero_pd();
+        for (size_t c = 0; c < 18; c++) acc = _mm256_fmadd_pd(_mm256_loadu_pd(u + c*lanes + l), _mm256_loadu_pd(v + c*lanes + l), acc);
+        _mm256_storeu_pd(out + l, acc);
+    }
+    reTraceMulDagBatchScalar(u, v, out, lanes, l);
+}
+
+static const KernelTable avx2Kernels = {"avx2", mulAvx2, mulDagLeftAvx2, mulDagRightAvx2,
+                                        reTraceMulAvx2, reTraceMulDagAvx2, traceMulDagAvx2,
+                                        mulBatchAvx2, reTraceMulDagBatchAvx2};
+
+//AVX-512: a whole row of three complex numbers fits in the low six lanes of one masked 512-bit register
+#define SU3_AVX512 __attribute__((target("avx512f")))
+#define SU3_ROW_MASK 0x3F
+
+SU3_AVX512 static void mulAvx512Core(const double* u, const double* v, double* out, bool conjLeft) {
+    __m512d row[3], swapped[3];
+    for (size_t k = 0; k < 3; k++) {
+        row[k] = _mm512_maskz_loadu_pd(SU3_ROW_MASK, v + 6*k);
+        swapped[k] = _mm512_shuffle_pd(row[k], row[k], 0x55);
+    }
+
+    const __m512d ones = _mm512_set1_pd(1.0);
+    __m512d r[3];
+    for (size_t i = 0; i < 3; i++) {
+        __m512d re = _mm512_setzero_pd(), im = _mm512_setzero_pd();
+        for (size_t k = 0; k < 3; k++) {
+            size_t e = conjLeft ? 2*(3*k+i) : 2*(3*i+k);
+            double ar = u[e], ai = conjLeft ? -u[e+1] : u[e+1];
+            re = _mm512_fmadd_pd(_mm512_set1_pd(ar), row[k], re);
+            im = _mm512_fmadd_pd(_mm512_set1_pd(ai), swapped[k], im);
+        }
+        r[i] = _mm512_fmaddsub_pd(ones, re, im);
+    }
+
+    for (size_t i = 0; i < 3; i++) _mm512_mask_storeu_pd(out + 6*i, SU3_ROW_MASK, r[i]);
+}
+
+SU3_AVX512 static double reTraceMulDagAvx512Core(const double* u, const double* v) {
+    __m512d acc = _mm512_mul_pd(_mm512_loadu_pd(u), _mm512_loadu_pd(v));
+    acc = _mm512_fmadd_pd(_mm512_loadu_pd(u + 8), _mm512_loadu_pd(v + 8), acc);
+    acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(0x3, u + 16), _mm512_maskz_loadu_pd(0x3, v + 16), acc);
+    double lanes[8];
+    _mm512_storeu_pd(lanes, acc);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+SU3_AVX512 static void mulAvx512(const cplx* u, const cplx* v, cplx* out) { mulAvx512Core(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out), false); }
+SU3_AVX512 static void mulDagLeftAvx512(const cplx* u, const cplx* v, cplx* out) { mulAvx512Core(AS_DOUBLE(u), AS_DOUBLE(v), AS_DOUBLE_OUT(out), true); }
+SU3_AVX512 static void mulDagRightAvx512(const cplx* u, const cplx* v, cplx* out) {
+    double vdag[18];
+    dagger(AS_DOUBLE(v), vdag);
+    mulAvx512Core(AS_DOUBLE(u), vdag, AS_DOUBLE_OUT(out), false);
+}
+SU3_AVX512 static double reTraceMulAvx512(const cplx* u, const cplx* v) { return reTraceMulScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+SU3_AVX512 static double reTraceMulDagAvx512(const cplx* u, const cplx* v) { return reTraceMulDagAvx512Core(AS_DOUBLE(u), AS_DOUBLE(v)); }
+SU3_AVX512 static cplx traceMulDagAvx512(const cplx* u, const cplx* v) { return traceMulDagScalar(AS_DOUBLE(u), AS_DOUBLE(v)); }
+
+//Batches: one 512-bit register holds an element of eight lanes, with a partial last group of lanes masked
+SU3_AVX512 static void mulBatchAvx512(const double* u, const double* v, double* out, size_t lanes) {
+    for (size_t l = 0; l < lanes; l += 8) {
+        const __mmask8 mask = (lanes - l >= 8) ? 0xFF : static_cast<__mmask8>((1u << (lanes - l)) - 1);
+        __m512d r[18];
+        for (size_t i = 0; i < 3; i++) {
+            for (size_t j = 0; j < 3; j++) {
+                __m512d re = _mm512_setzero_pd(), im = _mm512_setzero_pd();
+                for (size_t k = 0; k < 3; k++) {
+                    __m512d ur = _mm512_maskz_loadu_pd(mask, u + 2*(3*i+k)*lanes + l), ui = _mm512_maskz_loadu_pd(mask, u + (2*(3*i+k)+1)*lanes + l);
+                    __m512d vr = _mm512_maskz_loadu_pd(mask, v + 2*(3*k+j)*lanes + l), vi = _mm512_maskz_loadu_pd(mask, v + (2*(3*k+j)+1)*lanes + l);
+                    re = _mm512_fnmadd_pd(ui, vi, _mm512_fmadd_pd(ur, vr, re));
+                    im = _mm512_fmadd_pd(ui, vr, _mm512_fmadd_pd(ur, vi, im));
+                }
+                r[2*(3*i+j)] = re;
+                r[2*(3*i+j)+1] = im;
+            }
+        }
+        for (size_t c = 0; c < 18; c++) _mm512_mask_storeu_pd(out + c*lanes + l, mask, r[c]);
+    }
+}
+
+SU3_AVX512 static void reTraceMulDagBatchAvx512(const double* u, const double* v, double* out, size_t lanes) {
+    for (size_t l = 0; l < lanes; l += 8) {
+        const __mmask8 mask = (lanes - l >= 8) ? 0xFF : static_cast<__mmask8>((1u << (lanes - l)) - 1);
+        __m512d acc = _mm512_setzero_pd();
+        for (size_t c = 0; c < 18; c++) acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, u + c*lanes + l), _mm512_maskz_loadu_pd(mask, v + c*lanes + l), acc);
+        _mm512_mask_storeu_pd(out + l, mask, acc);
+    }
+}
+
+static const KernelTable avx512Kernels = {"avx512", mulAvx512, mulDagLeftAvx512, mulDagRightAvx512,
+                                          reTraceMulAvx512, reTraceMulDagAvx512, traceMulDagAvx512,
+                                          mulBatchAvx512, reTraceMulDagBatchAvx512};
+#endif
+
+std::vector<std::string> availableKernels() {
+    /*List kernel sets supported by this CPU, fastest last*/
+    std::vector<std::string> names = {portableKernels.name};
+#ifdef SU3_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) names.push_back(avx2Kernels.name);
+    if (__builtin_cpu_supports("avx512f")) names.push_back(avx512Kernels.name);
+#endif
+    return names;
+}
+
+static const KernelTable* findKernels(std::string name) {
+    /*Look up named kernel set, the fastest supported one for "auto", or null if unavailable*/
+    std::vector<std::string> names = availableKernels();
+    if (name == "auto") name = names.back();
+    if (std::find(names.begin(), names.end(), name) == names.end()) return nullptr;
+#ifdef SU3_X86
+    if (name == avx2Kernels.name) return &avx2Kernels;
+    if (name == avx512Kernels.name) return &avx512Kernels;
+#endif
+    return &portableKernels;
+}
+
+bool selectKernels(std::string name) {
+    /*Switch to named kernel set. Returns false if it is not supported*/
+    const KernelTable* table = findKernels(name);
+    if (table == nullptr) return false;
+    kernels = *table;
+    return true;
+}
+
+bool project(cplx* u) {
+    /*Replace u by the SU(3) matrix W maximising Re tr(u^dagger.W): the unitary factor of the polar decomposition
+    u = W.H, found by Newton iteration W -> (z.W + W^-dagger/z)/2 with determinant scaling z = |det W|^-1/3, times
+    the cube root of det(W)^* that maximises the trace. Unlike reunitarise, this commutes with gauge transformations,
+    g.u.h^dagger -> g.W.h^dagger. Returns false, leaving u unchanged, if u is singular or not finite*/
+    cplx w[9], next[9];
+    std::copy(u, u + 9, w);
+    for (size_t iteration = 0; iteration < 100; iteration++) {
+        cplx d = det(w);
+        if (!(std::abs(d) > 1e-300) || !std::isfinite(std::abs(d))) return false;
+        const double z = std::pow(std::abs(d), -1./3.);
+        //Rows of the inverse from the adjugate; W^-dagger(i,j) is the conjugate of inverse(j,i)
+        const cplx inverse[9] = {w[4]*w[8] - w[5]*w[7], w[2]*w[7] - w[1]*w[8], w[1]*w[5] - w[2]*w[4],
+                                 w[5]*w[6] - w[3]*w[8], w[0]*w[8] - w[2]*w[6], w[2]*w[3] - w[0]*w[5],
+                                 w[3]*w[7] - w[4]*w[6], w[1]*w[6] - w[0]*w[7], w[0]*w[4] - w[1]*w[3]};
+        double change = 0;
+        for (size_t i = 0; i < 3; i++) {
+            for (size_t j = 0; j < 3; j++) {
+                next[3*i+j] = 0.5*(z*w[3*i+j] + std::conj(inverse[3*j+i]/d)/z);
+                change = std::max(change, std::abs(next[3*i+j] - w[3*i+j]));
+            }
+        }
+        std::copy(next, next + 9, w);
+        if (change < 1e-12) break; //Convergence is quadratic, so the last step is already at rounding
+    }
+
+    const double phase = std::arg(det(w));
+    cplx overlap = 0;
+    for (size_t k = 0; k < 9; k++) overlap += std::conj(u[k])*w[k];
+    cplx best = 1.;
+    for (int k = 0; k < 3; k++) { //Loop over the cube roots of det(W)^*
+        cplx root = std::polar(1., -(phase + 2.*M_PI*k)/3.);
+        if (k == 0 || (root*overlap).real() > (best*overlap).real()) best = root;
+    }
+    for (size_t k = 0; k < 9; k++) u[k] = best*w[k];
+    return true;
+}
+
+KernelTable kernels = *findKernels("auto");
+
+}
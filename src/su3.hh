@@ -0,0 +1,106 @@
+#ifndef SU3_HH_
+#define SU3_HH_
+
+//C++
+#include <complex>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace su3 {
+	/*Small kernels for 3x3 complex matrices stored as 9 row-major std::complex<double>.
+	All kernels read their inputs completely before writing, so the output may alias either input.
+	A portable scalar implementation is always available, AVX2 and AVX-512 implementations are selected at start-up
+	if the CPU supports them.
+	The batch kernels apply the same operation to the matrices of several configurations at once, held
+	lane-interleaved as doubles: the real part of element e of lane l at [2e*lanes + l] and its imaginary part at
+	[(2e+1)*lanes + l], so that each vector register holds one element of consecutive lanes*/
+
+	typedef std::complex<double> cplx;
+
+	struct KernelTable {
+		const char* name;
+		void (*mul)(const cplx*, const cplx*, cplx*); //U.V
+		void (*mulDagLeft)(const cplx*, const cplx*, cplx*); //U^dagger.V
+		void (*mulDagRight)(const cplx*, const cplx*, cplx*); //U.V^dagger
+		double (*reTraceMul)(const cplx*, const cplx*); //Re tr(U.V)
+		double (*reTraceMulDag)(const cplx*, const cplx*); //Re tr(U.V^dagger)
+		cplx (*traceMulDag)(const cplx*, const cplx*); //tr(U.V^dagger)
+		void (*mulBatch)(const double*, const double*, double*, size_t); //U.V in every lane
+		void (*reTraceMulDagBatch)(const double*, const double*, double*, size_t); //Re tr(U.V^dagger) of every lane
+	};
+
+	extern KernelTable kernels;
+
+	bool selectKernels(std::string);
+	std::vector<std::string> availableKernels();
+
+	inline void mul(const cplx* u, const cplx* v, cplx* out) { kernels.mul(u, v, out); }
+	inline void mulDagLeft(const cplx* u, const cplx* v, cplx* out) { kernels.mulDagLeft(u, v, out); }
+	inline void mulDagRight(const cplx* u, const cplx* v, cplx* out) { kernels.mulDagRight(u, v, out); }
+	inline double reTraceMul(const cplx* u, const cplx* v) { return kernels.reTraceMul(u, v); }
+	inline double reTraceMulDag(const cplx* u, const cplx* v) { return kernels.reTraceMulDag(u, v); }
+	inline cplx traceMulDag(const cplx* u, const cplx* v) { return kernels.traceMulDag(u, v); }
+	inline void mulBatch(const double* u, const double* v, double* out, size_t lanes) { kernels.mulBatch(u, v, out, lanes); }
+	inline void reTraceMulDagBatch(const double* u, const double* v, double* out, size_t lanes) { kernels.reTraceMulDagBatch(u, v, out, lanes); }
+
+	inline void setIdentity(cplx* out) {
+		for (size_t i = 0; i < 9; i++) out[i] = (i%4 == 0) ? 1.0 : 0.0;
+	}
+
+	inline cplx trace(const cplx* u) {
+		return u[0] + u[4] + u[8];
+	}
+
+	inline cplx det(const cplx* u) {
+		/*Closed-form determinant by cofactor expansion along the first row*/
+		return u[0]*(u[4]*u[8] - u[5]*u[7]) - u[1]*(u[3]*u[8] - u[5]*u[6]) + u[2]*(u[3]*u[7] - u[4]*u[6]);
+	}
+
+	inline double unitarityDeviation(const cplx* u) {
+		/*Largest absolute element of U.U^dagger - 1*/
+		double deviation = 0;
+		for (size_t i = 0; i < 3; i++) {
+			for (size_t j = 0; j < 3; j++) {
+				cplx element = (i == j) ? -1.0 : 0.0;
+				for (size_t k = 0; k < 3; k++) element += u[3*i+k]*std::conj(u[3*j+k]);
+				deviation = std::max(deviation, std::abs(element));
+			}
+		}
+		return deviation;
+	}
+
+	inline bool isSpecialUnitary(const cplx* u, double tolerance=1e-10) {
+		/*Unit determinant, compared relative to one in both parts, and unitarity to within tolerance*/
+		cplx d = det(u);
+		return std::abs((d.real() - 1.)/std::min(d.real(), 1.)) < tolerance
+			&& std::abs(((d.imag() + 1.) - 1.)/std::min(d.imag() + 1., 1.)) < tolerance
+			&& unitarityDeviation(u) < tolerance;
+	}
+
+	inline void reunitarise(cplx* u) {
+		/*Project onto SU(3) in place: Gram-Schmidt on the first two rows, third row as the conjugate of their cross product*/
+		double norm = 0;
+		for (size_t k = 0; k < 3; k++) norm += std::norm(u[k]);
+		norm = 1./std::sqrt(norm);
+		for (size_t k = 0; k < 3; k++) u[k] *= norm;
+
+		cplx overlap = 0;
+		for (size_t k = 0; k < 3; k++) overlap += std::conj(u[k])*u[3+k];
+		norm = 0;
+		for (size_t k = 0; k < 3; k++) {
+			u[3+k] -= overlap*u[k];
+			norm += std::norm(u[3+k]);
+		}
+		norm = 1./std::sqrt(norm);
+		for (size_t k = 0; k < 3; k++) u[3+k] *= norm;
+
+		u[6] = std::conj(u[1]*u[5] - u[2]*u[4]);
+		u[7] = std::conj(u[2]*u[3] - u[0]*u[5]);
+		u[8] = std::conj(u[0]*u[4] - u[1]*u[3]);
+	}
+
+	bool project(cplx*);
+}
+
+#endif /* SU3_HH_ */
@@ -0,0 +1,159 @@
+#include "temporalgauge.hh"
+
+void fixTemporalGauge(LinkField& links) {
+    /*Transform links in place to temporal gauge with g(x,0) = 1 and g(x,t+1) = g(x,t).U_t(x,t), so that
+    U_i(x,t) -> g(x,t).U_i(x,t).g(x+i,t)^dagger, U_t(x,t) -> 1 for t < Nt-1 and U_t(x,Nt-1) -> g(x,Nt-1).U_t(x,Nt-1) = P(x).
+    Gauge-invariant observables are unchanged up to rounding*/
+    const size_t n = LinkField::linkSize;
+    const size_t nT = links.getShape()[3];
+    const size_t spatialVolume = links.getSpatialVolume();
+    std::vector<std::complex<double>> transform(spatialVolume*n), nextTransform(spatialVolume*n);
+    for (size_t s = 0; s < spatialVolume; s++) su3::setIdentity(transform.data() + s*n);
+
+    for (size_t t = 0; t < nT; t++) { //Loop over t
+        #pragma omp parallel for schedule(static)
+        for (size_t s = 0; s < spatialVolume; s++) { //Loop over sites in timeslice
+            const size_t site = t*spatialVolume + s;
+            const std::complex<double>* g = transform.data() + s*n;
+            std::complex<double> scratch[9], link[9];
+            for (size_t i = 0; i < 3; i++) { //Direction iteration
+                size_t neighbour = links.next(site, i) - t*spatialVolume;
+                su3::mul(g, links.fetch(site, i, scratch), link);
+                su3::mulDagRight(link, transform.data() + neighbour*n, link);
+                links.store(site, i, link);
+            }
+            std::complex<double>* gNext = nextTransform.data() + s*n;
+            su3::mul(g, links.fetch(site, 3, scratch), gNext);
+            if (t+1 < nT) {
+                su3::setIdentity(link);
+                links.store(site, 3, link);
+            } else {
+                links.store(site, 3, gNext); //g(x,0) = 1 so the last temporal link becomes the Polyakov line
+            }
+        }
+        std::swap(transform, nextTransform);
+    }
+}
+
+TemporalGaugeEngine::TemporalGaugeEngine(const LinkField& links, size_t maxR, size_t maxT) : _links(links), _maxR(maxR), _maxT(maxT) {
+    if (_maxT >= _links.getShape()[3]) throw std::runtime_error("Temporal gauge Wilson loops require T < Nt");
+}
+
+template <class Geometry>
+void TemporalGaugeEngine::buildLines(const Geometry& geometry, size_t site, size_t dir, std::complex<double>* lines,
+                                     std::complex<double>* upper, std::complex<double>* lower) {
+    /*Spatial lines S(x,r,t) for r <= maxR at every t in lines[t][r], starting from site on the first timeslice.
+    For loops crossing the last timeslice, S(x,r,t).P(x+r) is kept in upper[t-(Nt-maxT)][r] for the last maxT timeslices
+    and P(x).S(x,r,t) in lower[t][r] for the first maxT. Entries with r = 0 are unused*/
+    const size_t n = LinkField::linkSize;
+    const size_t nT = _links.getShape()[3];
+    const size_t spatialVolume = _links.getSpatialVolume();
+    const size_t last = (nT-1)*spatialVolume;
+    std::complex<double> scratch[9], polyakov[9];
+
+    for (size_t t = 0; t < nT; t++) { //Loop over t
+        std::complex<double>* line = lines + t*(_maxR+1)*n;
+        size_t point = site + t*spatialVolume;
+        const std::complex<double>* link = _links.fetch(point, dir, scratch);
+        std::copy(link, link + n, line + n);
+        for (size_t r = 2; r <= _maxR; r++) {
+            point = geometry.next(point, dir);
+            su3::mul(line + (r-1)*n, _links.fetch(point, dir, scratch), line + r*n);
+        }
+    }
+
+    const std::complex<double>* link = _links.fetch(last + site, 3, scratch);
+    std::copy(link, link + n, polyakov);
+    for (size_t t = 0; t < _maxT; t++) {
+        for (size_t r = 1; r <= _maxR; r++) su3::mul(polyakov, lines + (t*(_maxR+1) + r)*n, lower + (t*(_maxR+1) + r)*n);
+    }
+
+    size_t point = last + site;
+    for (size_t r = 1; r <= _maxR; r++) {
+        point = geometry.next(point, dir);
+        const std::complex<double>* shifted = _links.fetch(point, 3, scratch);
+        for (size_t t = nT - _maxT; t < nT; t++) {
+            su3::mul(lines + (t*(_maxR+1) + r)*n, shifted, upper + ((t - (nT - _maxT))*(_maxR+1) + r)*n);
+        }
+    }
+}
+
+template <class Geometry>
+void TemporalGaugeEngine::accumulateSite(const Geometry& geometry, size_t site, size_t dir, std::complex<double>* lines,
+                                         std::complex<double>* upper, std::complex<double>* lower, RunningStats* stats) {
+    /*Add all loops in spatial direction dir based at site on every timeslice to stats*/
+    const size_t n = LinkField::linkSize;
+    const size_t nT = _links.getShape()[3];
+    buildLines(geometry, site, dir, lines, upper, lower);
+
+    for (size_t t = 0; t < nT; t++) { //Loop over t
+        for (size_t R = 1; R <= _maxR; R++) {
+            const std::complex<double>* start = lines + (t*(_maxR+1) + R)*n;
+            for (size_t T = 1; T <= _maxT; T++) {
+                if (t + T < nT) {
+                    stats[index(R, T)].add(su3::reTraceMulDag(start, lines + ((t+T)*(_maxR+1) + R)*n)/3.);
+                } else { //Crosses the last timeslice
+                    stats[index(R, T)].add(su3::reTraceMulDag(upper + ((t - (nT - _maxT))*(_maxR+1) + R)*n, lower + ((t + T - nT)*(_maxR+1) + R)*n)/3.);
+                }
+            }
+        }
+    }
+}
+
+std::vector<RunningStats> TemporalGaugeEngine::calcStats() {
+    /*Mean, variance and count of Wilson loops for each (R,T), indexed by index(R,T). Loops with R = 0 or T = 0 are the identity*/
+    return dispatchGeometry(_links, [this](const auto& geometry) { return calcStats(geometry); });
+}
+
+template <class Geometry>
+std::vector<RunningStats> TemporalGaugeEngine::calcStats(const Geometry& geometry) {
+    /*Wilson loop statistics walking the lattice with the given geometry*/
+    const size_t n = LinkField::linkSize;
+    const size_t nT = _links.getShape()[3];
+    const size_t nX = _links.getShape()[0];
+    const size_t nRows = _links.getSpatialVolume()/nX;
+    const size_t nEntries = (_maxR+1)*(_maxT+1);
+
+    //Work items are rows of x sites in one direction, many more than there are threads. Statistics are kept per item
+    //and merged in a fixed order so that results do not depend on the thread count or schedule
+    const size_t nItems = 3*nRows;
+    std::vector<RunningStats> itemStats(nItems*nEntries);
+    struct Lines {
+        std::vector<std::complex<double>> lines, upper, lower;
+    };
+    auto setup = [&]() {
+        return Lines{std::vector<std::complex<double>>(nT*(_maxR+1)*n), std::vector<std::complex<double>>(_maxT*(_maxR+1)*n),
+                     std::vector<std::complex<double>>(_maxT*(_maxR+1)*n)};
+    };
+    auto work = [&](Lines& buffers, size_t item) {
+        const size_t row = item/3, i = item%3;
+        RunningStats* stats = itemStats.data() + item*nEntries;
+        for (size_t site = row*nX; site < (row+1)*nX; site++) { //Loop over x
+            accumulateSite(geometry, site, i, buffers.lines.data(), buffers.upper.data(), buffers.lower.data(), stats);
+        }
+    };
+    scheduleWork(std::vector<double>(nItems, 1.), setup, work);
+
+    RunningStats identity;
+    identity.count = 3*_links.getVolume();
+    identity.mean = 1.;
+    std::vector<RunningStats> stats(nEntries, identity);
+    for (size_t R = 1; R <= _maxR; R++) {
+        for (size_t T = 1; T <= _maxT; T++) {
+            RunningStats total;
+            for (size_t item = 0; item < nItems; item++) total.merge(itemStats[item*nEntries + index(R, T)]);
+            stats[index(R, T)] = total;
+        }
+    }
+    return stats;
+}
+
+timing::Work TemporalGaugeEngine::getWork() const {
+    /*Matrix products and bytes of links read by calcStats: per base site on the first timeslice and direction, the spatial
+    lines on every timeslice, their products with the Polyakov lines, then one trace for each (R,T) on each timeslice*/
+    const double maxR = _maxR, maxT = _maxT, nT = _links.getShape()[3];
+    const double bases = 3.*_links.getSpatialVolume();
+    const double products = nT*std::max(maxR-1, 0.) + 2*maxR*maxT + nT*maxR*maxT;
+    const double linkReads = nT*maxR + 1 + maxR;
+    return {bases*products, bases*linkReads*_links.getLinkBytes()};
+}
@@ -0,0 +1,45 @@
+#ifndef TEMPORALGAUGE_HH_
+#define TEMPORALGAUGE_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "geometry.hh"
+#include "statistics.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+
+void fixTemporalGauge(LinkField&);
+
+class TemporalGaugeEngine {
+	/*Mean and variance of planar Wilson loops for every (R,T) up to (maxR,maxT) on a configuration in temporal gauge, where every temporal
+	link is the identity apart from those on the last timeslice, which hold the Polyakov line P(x).
+	A loop based at timeslice t then reduces to Re tr[S(x,R,t).S(x,R,t+T)^dagger]/3 between spatial Wilson lines, or to
+	Re tr[S(x,R,t).P(x+R).S(x,R,t+T-Nt)^dagger.P(x)^dagger]/3 if it crosses the last timeslice. The spatial lines along
+	each spatial line of sites are built once for all t, after which each loop costs one trace, whatever T is*/
+
+private:
+	const LinkField& _links;
+	size_t _maxR, _maxT;
+
+	template <class Geometry>
+	void buildLines(const Geometry&, size_t, size_t, std::complex<double>*, std::complex<double>*, std::complex<double>*);
+	template <class Geometry>
+	void accumulateSite(const Geometry&, size_t, size_t, std::complex<double>*, std::complex<double>*, std::complex<double>*, RunningStats*);
+	template <class Geometry>
+	std::vector<RunningStats> calcStats(const Geometry&);
+
+public:
+	TemporalGaugeEngine(const LinkField&, size_t, size_t);
+	size_t index(size_t R, size_t T) const { return R*(_maxT+1) + T; }
+	std::vector<RunningStats> calcStats();
+	timing::Work getWork() const;
+};
+
+#endif /* TEMPORALGAUGE_HH_ */
@@ -0,0 +1,173 @@
+#include "topology.hh"
+
+namespace {
+    struct ProcessMask {
+        /*CPUs the process was allowed at start-up, before any thread was pinned*/
+        cpu_set_t mask;
+
+        ProcessMask() {
+            CPU_ZERO(&mask);
+            if (sched_getaffinity(0, sizeof(mask), &mask) != 0) CPU_SET(0, &mask);
+        }
+    };
+
+    const ProcessMask processMask;
+
+    int readInt(std::string path, int fallback) {
+        /*Integer held in a sysfs file, or fallback if it cannot be read*/
+        std::ifstream file(path);
+        int value;
+        return (file >> value) ? value : fallback;
+    }
+
+    std::set<int> parseCpuList(std::string text) {
+        /*CPUs in a sysfs list such as 0-3,8-11*/
+        std::set<int> cpus;
+        std::stringstream stream(text);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++) cpus.insert(cpu);
+            } catch (std::exception& e) {
+                continue;
+            }
+        }
+        return cpus;
+    }
+
+    std::string formatList(std::vector<int> values) {
+        /*Sorted values with runs written as ranges, e.g. 0-3,8*/
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        std::stringstream text;
+        for (size_t i = 0; i < values.size(); ) {
+            size_t j = i;
+            while (j+1 < values.size() && values[j+1] == values[j] + 1) j++;
+            text << (i > 0 ? "," : "") << values[i];
+            if (j > i) text << "-" << values[j];
+            i = j+1;
+        }
+        return text.str();
+    }
+}
+
+std::vector<topology::Cpu> topology::getCpus() {
+    /*CPUs the process may run on, with their NUMA node, package and core. Anything sysfs does not provide defaults to
+    node 0, package 0 and a core of its own*/
+    std::map<int, int> nodes;
+    glob_t matches;
+    if (glob("/sys/devices/system/node/node[0-9]*", 0, nullptr, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) {
+            std::string path = matches.gl_pathv[i];
+            int node = std::stoi(path.substr(path.find_last_of('e') + 1));
+            std::ifstream file(path + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            for (int cpu : parseCpuList(list)) nodes[cpu] = node;
+        }
+    }
+    globfree(&matches);
+
+    std::vector<Cpu> cpus;
+    for (int id = 0; id < CPU_SETSIZE; id++) {
+        if (!CPU_ISSET(id, &processMask.mask)) continue;
+        std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+        cpus.push_back({id, nodes.count(id) ? nodes[id] : 0, readInt(topology + "physical_package_id", 0), readInt(topology + "core_id", id)});
+    }
+    return cpus;
+}
+
+std::vector<topology::Cpu> topology::orderCpus(std::vector<Cpu> cpus, std::string policy) {
+    /*CPUs in the order threads are placed on them. Compact fills one NUMA node after another, spread alternates
+    between nodes. Either way each physical core gets a thread before any core gets a second on its SMT sibling*/
+    if (policy != "compact" && policy != "spread") throw std::runtime_error("Unknown thread affinity: " + policy);
+    std::sort(cpus.begin(), cpus.end(), [](const Cpu& a, const Cpu& b) { return std::tie(a.node, a.package, a.core, a.id) < std::tie(b.node, b.package, b.core, b.id); });
+
+    std::vector<Cpu> first, siblings;
+    std::set<std::pair<int, int>> cores;
+    for (const Cpu& cpu : cpus) {
+        if (cores.insert(std::make_pair(cpu.package, cpu.core)).second) first.push_back(cpu);
+        else siblings.push_back(cpu);
+    }
+    std::vector<Cpu> ordered;
+    for (std::vector<Cpu>* group : {&first, &siblings}) {
+        if (policy == "compact") {
+            ordered.insert(ordered.end(), group->begin(), group->end());
+            continue;
+        }
+        std::map<int, std::vector<Cpu>> byNode;
+        for (const Cpu& cpu : *group) byNode[cpu.node].push_back(cpu);
+        for (size_t i = 0; ordered.size() < (group == &first ? first.size() : cpus.size()); i++) { //Round robin over nodes
+            for (const auto& node : byNode) {
+                if (i < node.second.size()) ordered.push_back(node.second[i]);
+            }
+        }
+    }
+    return ordered;
+}
+
+std::vector<topology::Cpu> topology::pinThreads(std::string policy) {
+    /*Pin each OpenMP thread to one CPU in the order given by policy, or leave threads to the OS if policy is "none".
+    Returns the CPU of each thread. The OpenMP runtime keeps the same threads for later parallel regions of the same
+    size, so thread t stays on its CPU and the data it first touched stays local to it*/
+    if (policy == "none") return std::vector<Cpu>();
+    std::vector<Cpu> order = orderCpus(getCpus(), policy);
+    if (order.size() == 0) throw std::runtime_error("No CPUs available for pinning");
+
+    std::vector<Cpu> placement(getSchedulerThreads());
+    bool pinned = true;
+    #pragma omp parallel num_threads(placement.size())
+    {
+#ifdef _OPENMP
+        size_t thread = omp_get_thread_num();
+#else
+        size_t thread = 0;
+#endif
+        placement[thread] = order[thread%order.size()];
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(placement[thread].id, &mask);
+        if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+            #pragma omp atomic write
+            pinned = false;
+        }
+    }
+    if (!pinned) throw std::runtime_error("Could not pin threads to CPUs");
+    return placement;
+}
+
+void topology::releaseThread() {
+    /*Let the calling thread, and threads it starts, run on any CPU of the process again. For helper threads such as
+    background readers, which would otherwise share the CPU of the thread that started them*/
+    sched_setaffinity(0, sizeof(processMask.mask), &processMask.mask);
+}
+
+void topology::report(std::ostream& out, std::string policy, const std::vector<Cpu>& placement) {
+    /*Describe the CPUs available and where threads were placed*/
+    std::vector<Cpu> cpus = getCpus();
+    std::set<int> nodes, packages;
+    std::set<std::pair<int, int>> cores;
+    for (const Cpu& cpu : cpus) {
+        nodes.insert(cpu.node);
+        packages.insert(cpu.package);
+        cores.insert(std::make_pair(cpu.package, cpu.core));
+    }
+    out << "Topology: " << cpus.size() << " CPUs on " << cores.size() << " cores, " << packages.size() << " sockets and " << nodes.size() << " NUMA nodes\n";
+    if (placement.size() == 0) {
+        out << "Threads: " << getSchedulerThreads() << ", not pinned\n";
+        return;
+    }
+
+    std::map<int, std::pair<std::vector<int>, std::vector<int>>> byNode; //Threads and CPUs on each node
+    for (size_t thread = 0; thread < placement.size(); thread++) {
+        byNode[placement[thread].node].first.push_back(static_cast<int>(thread));
+        byNode[placement[thread].node].second.push_back(placement[thread].id);
+    }
+    out << "Threads: " << placement.size() << ", pinned " << policy << "\n";
+    for (const auto& node : byNode) {
+        out << "  node " << node.first << ": threads " << formatList(node.second.first) << " on CPUs " << formatList(node.second.second) << "\n";
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TOPOLOGY_HH_
+#define TOPOLOGY_HH_
+
+//C++
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <tuple>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+//POSIX
+#include <sched.h>
+#include <glob.h>
+//Project
+#include "scheduler.hh"
+
+namespace topology {
+	/*CPU topology of the node from sysfs, and pinning of OpenMP threads to it. Pinned threads first touch the link
+	storage in the same contiguous ranges of planes that the scheduler first gives them, so on a multi-socket node each
+	thread mostly reads memory attached to its own socket*/
+
+	struct Cpu {
+		int id;
+		int node; //NUMA node
+		int package; //Socket
+		int core; //Physical core within the package, shared by SMT siblings
+	};
+
+	std::vector<Cpu> getCpus();
+	std::vector<Cpu> orderCpus(std::vector<Cpu>, std::string);
+	std::vector<Cpu> pinThreads(std::string);
+	void releaseThread();
+	void report(std::ostream&, std::string, const std::vector<Cpu>&);
+}
+
+#endif /* TOPOLOGY_HH_ */
@@ -0,0 +1,133 @@
+#include "wilsonengine.hh"
+
+WilsonEngine::WilsonEngine(const LinkField& links, size_t maxR, size_t maxT) : _links(links), _maxR(maxR), _maxT(maxT) { }
+
+template <class Geometry>
+void WilsonEngine::buildLines(const Geometry& geometry, size_t site, size_t dir, std::complex<double>* spatial, std::complex<double>* temporal) {
+    /*Spatial lines S(x+tau*t, r) for tau <= maxT, r <= maxR in spatial[tau][r], and temporal lines L(x+r*dir, tau) in temporal[r][tau].
+    Entries with r = 0 (spatial) or tau = 0 (temporal) are unused*/
+    const size_t n = LinkField::linkSize;
+    std::complex<double> scratch[9];
+    size_t base = site;
+    for (size_t tau = 0; tau <= _maxT; tau++) { //Spatial lines at each height
+        std::complex<double>* line = spatial + tau*(_maxR+1)*n;
+        size_t point = base;
+        const std::complex<double>* link = _links.fetch(point, dir, scratch);
+        std::copy(link, link + n, line + n);
+        for (size_t r = 2; r <= _maxR; r++) {
+            point = geometry.next(point, dir);
+            su3::mul(line + (r-1)*n, _links.fetch(point, dir, scratch), line + r*n);
+        }
+        base = geometry.next(base, 3);
+    }
+
+    base = site;
+    for (size_t r = 0; r <= _maxR; r++) { //Temporal lines at each distance
+        std::complex<double>* line = temporal + r*(_maxT+1)*n;
+        size_t point = base;
+        const std::complex<double>* link = _links.fetch(point, 3, scratch);
+        std::copy(link, link + n, line + n);
+        for (size_t tau = 2; tau <= _maxT; tau++) {
+            point = geometry.next(point, 3);
+            su3::mul(line + (tau-1)*n, _links.fetch(point, 3, scratch), line + tau*n);
+        }
+        base = geometry.next(base, dir);
+    }
+}
+
+template <class Geometry>
+void WilsonEngine::accumulateSite(const Geometry& geometry, size_t site, size_t dir, std::complex<double>* spatial, std::complex<double>* temporal, RunningStats* stats) {
+    /*Add all loops based at site in spatial direction dir to stats*/
+    const size_t n = LinkField::linkSize;
+    buildLines(geometry, site, dir, spatial, temporal);
+
+    std::complex<double> upper[9], lower[9];
+    for (size_t R = 1; R <= _maxR; R++) {
+        for (size_t T = 1; T <= _maxT; T++) {
+            su3::mul(spatial + R*n, temporal + (R*(_maxT+1) + T)*n, upper); //S(x,R).L(x+R,T)
+            su3::mul(temporal + T*n, spatial + (T*(_maxR+1) + R)*n, lower); //L(x,T).S(x+T,R)
+            stats[index(R, T)].add(su3::reTraceMulDag(upper, lower)/3.);
+        }
+    }
+}
+
+std::vector<RunningStats> WilsonEngine::calcStats() {
+    /*Mean, variance and count of Wilson loops for each (R,T), indexed by index(R,T). Loops with R = 0 or T = 0 are the identity*/
+    return combineSliceStats(calcSliceStats(_links.getShape()[3]));
+}
+
+std::vector<RunningStats> WilsonEngine::calcSliceStats(size_t nSlices) {
+    /*Statistics of Wilson loops based in each of the first nSlices timeslices, indexed by t*getEntries() + index(R,T).
+    Loops may extend up to maxT timeslices beyond the last base timeslice*/
+    return calcSliceStats(0, nSlices);
+}
+
+std::vector<RunningStats> WilsonEngine::calcSliceStats(size_t first, size_t nSlices) {
+    /*Statistics of Wilson loops based in the nSlices timeslices from first, indexed by (t - first)*getEntries() + index(R,T).
+    Each timeslice gives the same statistics however the range is split*/
+    return dispatchGeometry(_links, [this, first, nSlices](const auto& geometry) { return calcSliceStats(geometry, first, nSlices); });
+}
+
+std::vector<RunningStats> WilsonEngine::combineSliceStats(const std::vector<RunningStats>& sliceStats) const {
+    /*Statistics over all base sites from per-timeslice statistics. Timeslices are merged in order, so the result
+    does not depend on how they were shared between threads or processes*/
+    const size_t nEntries = getEntries();
+    const size_t nSlices = sliceStats.size()/nEntries;
+    RunningStats identity;
+    identity.count = 3*_links.getSpatialVolume()*nSlices;
+    identity.mean = 1.;
+
+    std::vector<RunningStats> stats(nEntries, identity);
+    for (size_t R = 1; R <= _maxR; R++) {
+        for (size_t T = 1; T <= _maxT; T++) {
+            RunningStats total;
+            for (size_t t = 0; t < nSlices; t++) total.merge(sliceStats[t*nEntries + index(R, T)]);
+            stats[index(R, T)] = total;
+        }
+    }
+    return stats;
+}
+
+template <class Geometry>
+std::vector<RunningStats> WilsonEngine::calcSliceStats(const Geometry& geometry, size_t first, size_t nSlices) {
+    /*Per-timeslice Wilson loop statistics walking the lattice with the given geometry*/
+    const size_t n = LinkField::linkSize;
+    const size_t planeSites = _links.getShape()[0]*_links.getShape()[1];
+    const size_t nPlanes = _links.getShape()[2];
+    const size_t nEntries = getEntries();
+
+    //Work items are the z planes of each timeslice, so there are many more items than threads. Statistics are kept
+    //per plane and merged in a fixed order so that results do not depend on the thread count or schedule
+    std::vector<RunningStats> planeStats(nSlices*nPlanes*nEntries);
+    auto setup = [&]() {
+        return std::make_pair(std::vector<std::complex<double>>((_maxT+1)*(_maxR+1)*n), std::vector<std::complex<double>>((_maxR+1)*(_maxT+1)*n));
+    };
+    auto work = [&](std::pair<std::vector<std::complex<double>>, std::vector<std::complex<double>>>& lines, size_t plane) {
+        RunningStats* stats = planeStats.data() + plane*nEntries;
+        const size_t offset = (first*nPlanes + plane)*planeSites;
+        for (size_t site = offset; site < offset + planeSites; site++) { //Loop over sites in plane
+            for (size_t i = 0; i < 3; i++) { //Direction iteration
+                accumulateSite(geometry, site, i, lines.first.data(), lines.second.data(), stats);
+            }
+        }
+    };
+    scheduleWork(std::vector<double>(nSlices*nPlanes, 1.), setup, work);
+
+    std::vector<RunningStats> sliceStats(nSlices*nEntries);
+    for (size_t t = 0; t < nSlices; t++) { //Loop over t
+        for (size_t z = 0; z < nPlanes; z++) {
+            for (size_t e = 0; e < nEntries; e++) sliceStats[t*nEntries + e].merge(planeStats[(t*nPlanes + z)*nEntries + e]);
+        }
+    }
+    return sliceStats;
+}
+
+timing::Work WilsonEngine::getWork(size_t nSlices) const {
+    /*Matrix products and bytes of links read by calcSliceStats(nSlices): per base site and direction, the line
+    extensions, then two products and a trace for each (R,T)*/
+    const double maxR = _maxR, maxT = _maxT;
+    const double bases = 3.*_links.getSpatialVolume()*nSlices;
+    const double lineProducts = (maxT+1)*std::max(maxR-1, 0.) + (maxR+1)*std::max(maxT-1, 0.);
+    const double linkReads = (maxT+1)*maxR + (maxR+1)*maxT;
+    return {bases*(lineProducts + 3*maxR*maxT), bases*linkReads*_links.getLinkBytes()};
+}
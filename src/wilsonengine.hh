@@ -0,0 +1,45 @@
+#ifndef WILSONENGINE_HH_
+#define WILSONENGINE_HH_
+
+//C++
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+//Project
+#include "linkfield.hh"
+#include "su3.hh"
+#include "geometry.hh"
+#include "statistics.hh"
+#include "instrument.hh"
+#include "scheduler.hh"
+
+class WilsonEngine {
+	/*Mean and variance of planar Wilson loops for every (R,T) up to (maxR,maxT) in a single pass over the lattice.
+	For each base site and spatial direction the spatial and temporal Wilson lines are extended one link at a time,
+	after which each loop W(R,T) = Re tr[(S(x,R).L(x+R,T)).(L(x,T).S(x+T,R))^dagger]/3 costs two multiplications
+	and a trace rather than 2(R+T) multiplications*/
+
+private:
+	const LinkField& _links;
+	size_t _maxR, _maxT;
+
+	template <class Geometry>
+	void buildLines(const Geometry&, size_t, size_t, std::complex<double>*, std::complex<double>*);
+	template <class Geometry>
+	void accumulateSite(const Geometry&, size_t, size_t, std::complex<double>*, std::complex<double>*, RunningStats*);
+	template <class Geometry>
+	std::vector<RunningStats> calcSliceStats(const Geometry&, size_t, size_t);
+
+public:
+	WilsonEngine(const LinkField&, size_t, size_t);
+	size_t index(size_t R, size_t T) const { return R*(_maxT+1) + T; }
+	size_t getEntries() const { return (_maxR+1)*(_maxT+1); }
+	std::vector<RunningStats> calcStats();
+	std::vector<RunningStats> calcSliceStats(size_t);
+	std::vector<RunningStats> calcSliceStats(size_t, size_t);
+	std::vector<RunningStats> combineSliceStats(const std::vector<RunningStats>&) const;
+	timing::Work getWork(size_t) const;
+};
+
+#endif /* WILSONENGINE_HH_ */
@@ -0,0 +1,119 @@
+#include "testsu3.hh"
+
+double tolerence = 1e-13;
+size_t nTrials = 1000;
+
+su3Matrix randomMatrix(std::mt19937_64& generator) {
+    /*Matrix with normally distributed complex elements*/
+    std::normal_distribution<double> gaus;
+    su3Matrix m;
+    for (size_t i = 0; i < 9; i++) m[i] = std::complex<double>{gaus(generator), gaus(generator)};
+    return m;
+}
+
+double maxDifference(const su3Matrix& a, const su3::cplx* b) {
+    /*Largest absolute difference between elements*/
+    double dif = 0;
+    for (size_t i = 0; i < 9; i++) dif = std::max(dif, std::abs(a[i] - b[i]));
+    return dif;
+}
+
+bool check(std::string name, double dif) {
+    /*Report comparison to xtensor result*/
+    if (dif < tolerence) return true;
+    std::cout << name << " differs from xtensor result by " << dif << "\n";
+    return false;
+}
+
+bool testKernels(std::string kernelName) {
+    /*Compare selected kernel set to xtensor-blas products on random matrices*/
+    std::cout << "Testing " << kernelName << " kernels\n";
+    su3::selectKernels(kernelName);
+    std::mt19937_64 generator(1234);
+    bool pass = true;
+
+    for (size_t n = 0; n < nTrials; n++) {
+        su3Matrix u = randomMatrix(generator);
+        su3Matrix v = randomMatrix(generator);
+        su3Matrix udag = xt::conj(xt::transpose(u));
+        su3Matrix vdag = xt::conj(xt::transpose(v));
+        su3::cplx out[9];
+
+        su3Matrix target = xt::linalg::dot(u, v);
+        su3::mul(u.data(), v.data(), out);
+        pass &= check("U.V", maxDifference(target, out));
+        double reTrace = xt::sum(xt::diagonal(target))[0].real();
+        pass &= check("Re tr(U.V)", std::abs(su3::reTraceMul(u.data(), v.data()) - reTrace));
+
+        target = xt::linalg::dot(udag, v);
+        su3::mulDagLeft(u.data(), v.data(), out);
+        pass &= check("U^dagger.V", maxDifference(target, out));
+
+        target = xt::linalg::dot(u, vdag);
+        su3::mulDagRight(u.data(), v.data(), out);
+        pass &= check("U.V^dagger", maxDifference(target, out));
+        std::complex<double> trace = xt::sum(xt::diagonal(target))[0];
+        pass &= check("Re tr(U.V^dagger)", std::abs(su3::reTraceMulDag(u.data(), v.data()) - trace.real()));
+        pass &= check("tr(U.V^dagger)", std::abs(su3::traceMulDag(u.data(), v.data()) - trace));
+
+        //Outputs may alias inputs
+        su3Matrix alias = v;
+        su3::mulDagLeft(u.data(), alias.data(), alias.data());
+        pass &= check("U^dagger.V in place", maxDifference(xt::linalg::dot(udag, v), alias.data()));
+        alias = u;
+        su3::mulDagLeft(alias.data(), v.data(), alias.data());
+        pass &= check("U^dagger.V in place on U", maxDifference(xt::linalg::dot(udag, v), alias.data()));
+        alias = u;
+        su3::mul(alias.data(), v.data(), alias.data());
+        pass &= check("U.V in place on U", maxDifference(xt::linalg::dot(u, v), alias.data()));
+
+        if (!pass) break;
+    }
+
+    for (size_t lanes : {1, 4, 5, 8, 11}) { //Full and partial groups of vector lanes
+        for (size_t n = 0; n < nTrials/10 && pass; n++) {
+            std::vector<su3Matrix> u, v;
+            std::vector<double> uBatch(18*lanes), vBatch(18*lanes), outBatch(18*lanes), traces(lanes);
+            for (size_t l = 0; l < lanes; l++) {
+                u.push_back(randomMatrix(generator));
+                v.push_back(randomMatrix(generator));
+                for (size_t e = 0; e < 9; e++) {
+                    uBatch[2*e*lanes + l] = u[l][e].real();
+                    uBatch[(2*e+1)*lanes + l] = u[l][e].imag();
+                    vBatch[2*e*lanes + l] = v[l][e].real();
+                    vBatch[(2*e+1)*lanes + l] = v[l][e].imag();
+                }
+            }
+            su3::mulBatch(uBatch.data(), vBatch.data(), outBatch.data(), lanes);
+            su3::reTraceMulDagBatch(uBatch.data(), vBatch.data(), traces.data(), lanes);
+            su3::mulBatch(uBatch.data(), vBatch.data(), uBatch.data(), lanes); //Outputs may alias inputs
+            for (size_t l = 0; l < lanes; l++) {
+                su3Matrix target = xt::linalg::dot(u[l], v[l]);
+                su3::cplx out[9], alias[9];
+                for (size_t e = 0; e < 9; e++) {
+                    out[e] = su3::cplx(outBatch[2*e*lanes + l], outBatch[(2*e+1)*lanes + l]);
+                    alias[e] = su3::cplx(uBatch[2*e*lanes + l], uBatch[(2*e+1)*lanes + l]);
+                }
+                pass &= check("Batched U.V", maxDifference(target, out));
+                pass &= check("Batched U.V in place on U", maxDifference(target, alias));
+                su3Matrix vdag = xt::conj(xt::transpose(v[l]));
+                double reTrace = xt::sum(xt::diagonal(xt::linalg::dot(u[l], vdag)))[0].real();
+                pass &= check("Batched Re tr(U.V^dagger)", std::abs(traces[l] - reTrace));
+            }
+        }
+    }
+    return pass;
+}
+
+int main() {
+    /*Check hand-written SU(3) kernels against xtensor for every kernel set this CPU supports*/
+    bool pass = true;
+    for (std::string name : su3::availableKernels()) pass &= testKernels(name);
+
+    if (!pass) {
+        std::cout << "SU(3) kernel test failed\n";
+        return 1;
+    }
+    std::cout << "All SU(3) kernels agree with xtensor\n";
+    return 0;
+}
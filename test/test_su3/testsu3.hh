@@ -0,0 +1,21 @@
+#ifndef TESTSU3_HH_
+#define TESTSU3_HH_
+//C++
+#include <string>
+#include <iostream>
+#include <vector>
+#include <array>
+#include <complex>
+#include <random>
+#include <stdlib.h>
+#include <math.h>
+
+#include "xtensor/xfixed.hpp"
+#include "xtensor/xtensor.hpp"
+#include "xtensor/xio.hpp"
+#include "xtensor-blas/xlinalg.hpp"
+
+#include "su3.hh"
+#include "misc.hh"
+
+#endif /* TESTSU3_HH_ */